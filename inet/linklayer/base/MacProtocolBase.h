@@ -21,6 +21,8 @@
 #include "inet/common/LayeredProtocolBase.h"
 #include "inet/common/lifecycle/ModuleOperations.h"
 #include "inet/common/packet/Packet.h"
+#include "inet/common/Simsignals.h"
+#include "inet/linklayer/common/MacAddressTag_m.h"
 #include "inet/queueing/contract/IPacketQueue.h"
 #include "inet/networklayer/common/InterfaceEntry.h"
 
@@ -31,6 +33,34 @@ class INET_API MacProtocolBase : public LayeredProtocolBase, public cListener
   public:
     InterfaceEntry *interfaceEntry = nullptr;
 
+    /**
+     * Drops frames waiting in the transmission queue for the given destination,
+     * e.g. a routing parent found unreachable, instead of letting each of them
+     * exhaust its retransmissions. The frame currently being transmitted is left alone.
+     * Returns the number of dropped frames.
+     */
+    virtual int dropQueuedFrames(const MacAddress& destAddress)
+    {
+        Enter_Method("dropQueuedFrames");
+        int numDropped = 0;
+        if (txQueue == nullptr)
+            return numDropped;
+        for (int i = txQueue->getNumPackets() - 1; i >= 0; i--) {
+            auto packet = txQueue->getPacket(i);
+            auto macAddressReq = packet->findTag<MacAddressReq>();
+            if (macAddressReq == nullptr || macAddressReq->getDestAddress() != destAddress)
+                continue;
+            txQueue->removePacket(packet);
+            take(packet);
+            PacketDropDetails details;
+            details.setReason(NO_ROUTE_FOUND);
+            emit(packetDroppedSignal, packet, &details);
+            delete packet;
+            numDropped++;
+        }
+        return numDropped;
+    }
+
   protected:
     /** @brief Gate ids */
     //@{
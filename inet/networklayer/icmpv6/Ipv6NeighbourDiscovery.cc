@@ -18,6 +18,7 @@
 
 #include "inet/common/ModuleAccess.h"
 #include "inet/common/ProtocolTag_m.h"
+#include "inet/common/Simsignals.h"
 #include "inet/common/lifecycle/NodeStatus.h"
 #include "inet/linklayer/common/InterfaceTag_m.h"
 #include "inet/networklayer/common/HopLimitTag_m.h"
@@ -773,6 +774,43 @@ void Ipv6NeighbourDiscovery::dropQueuedPacketsAwaitingAr(Neighbour *nce)
     neighbourCache.remove(nceKey->address, nceKey->interfaceID);
 }
 
+int Ipv6NeighbourDiscovery::redirectPendingPackets(const Ipv6Address& oldNextHop, int oldInterfaceId,
+        const Ipv6Address& newNextHop, int newInterfaceId)
+{
+    Enter_Method("redirectPendingPackets");
+
+    int numDropped = 0;
+    Neighbour *nce = neighbourCache.lookup(oldNextHop, oldInterfaceId);
+    if (nce == nullptr || nce->pendingPackets.empty())
+        return numDropped;
+
+    MsgPtrVector pendingPackets;
+    pendingPackets.swap(nce->pendingPackets);
+    EV_INFO << "Next hop " << oldNextHop << " unreachable, " << pendingPackets.size()
+            << " packets awaiting its address resolution" << endl;
+
+    for (auto packet : pendingPackets) {
+        pendingQueue.remove(packet);
+        const auto& ipv6Header = packet->peekAtFront<Ipv6Header>();
+        if (newNextHop.isUnspecified() || ipv6Header->getDestAddress() == oldNextHop) {
+            EV_INFO << "Dropping " << packet << endl;
+            PacketDropDetails details;
+            details.setReason(NO_ROUTE_FOUND);
+            emit(packetDroppedSignal, packet, &details);
+            delete packet;
+            numDropped++;
+        }
+        else {
+            EV_INFO << "Redirecting " << packet << " to " << newNextHop << endl;
+            Ipv6NdControlInfo *ctrl = check_and_cast<Ipv6NdControlInfo *>(packet->getControlInfo());
+            ctrl->setNextHop(newNextHop);
+            ctrl->setInterfaceId(newInterfaceId);
+            processIpv6Datagram(packet);
+        }
+    }
+    return numDropped;
+}
+
 void Ipv6NeighbourDiscovery::sendPacketToIpv6Module(Packet *msg, const Ipv6Address& destAddr, const Ipv6Address& srcAddr, int interfaceId, double delay)
 {
 
@@ -92,6 +92,17 @@ class INET_API Ipv6NeighbourDiscovery : public cSimpleModule, public LifecycleUn
      */
     virtual void reachabilityConfirmed(const Ipv6Address& neighbour, int interfaceId);
 
+    /**
+     * Public method, to be invoked by a routing protocol once the given next hop
+     * is found unreachable. Packets queued awaiting its address resolution are
+     * handed over to the new next hop or, if the latter is unspecified (or the
+     * packet is destined to the old next hop itself), dropped straight away
+     * instead of waiting for the resolution to time out.
+     * Returns the number of dropped packets.
+     */
+    virtual int redirectPendingPackets(const Ipv6Address& oldNextHop, int oldInterfaceId,
+            const Ipv6Address& newNextHop, int newInterfaceId);
+
   protected:
 
     //Packets awaiting Address Resolution or Next-Hop Determination.
@@ -395,7 +406,6 @@ class INET_API Ipv6NeighbourDiscovery : public cSimpleModule, public LifecycleUn
     virtual void sendSolicitedNa(Packet *packet, const Ipv6NeighbourSolicitation *ns, InterfaceEntry *ie);
 
     /** CUSTOM WIND PART **/
-    bool isAppPacket(Packet *packet);
     double pRandomDelayMin;
     double pRandomDelayMax;
 
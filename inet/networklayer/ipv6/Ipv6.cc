@@ -31,6 +31,7 @@
 #include "inet/networklayer/common/HopLimitTag_m.h"
 #include "inet/networklayer/common/L3AddressTag_m.h"
 #include "inet/networklayer/common/L3Tools.h"
+#include "inet/networklayer/common/NextHopAddressTag_m.h"
 #include "inet/networklayer/common/TosTag_m.h"
 #include "inet/networklayer/contract/IInterfaceTable.h"
 #include "inet/networklayer/contract/ipv6/Ipv6SocketCommand_m.h"
@@ -374,10 +375,9 @@ void Ipv6::datagramLocalOut(Packet *packet, const InterfaceEntry *destIE, Ipv6Ad
         routeMulticastPacket(packet, destIE, nullptr, true);
 }
 
-bool Ipv6::isAppPacket(Packet *packet) {
-    std::string packetName(packet->getFullName());
-
-    return packetName.find("App") != std::string::npos;
+bool Ipv6::isAppPacket(const Ptr<const Ipv6Header>& ipv6Header) {
+    auto protocolId = ipv6Header->getProtocolId();
+    return protocolId == IP_PROT_UDP || protocolId == IP_PROT_TCP;
 }
 
 void Ipv6::routePacket(Packet *packet, const InterfaceEntry *destIE, const InterfaceEntry *fromIE, Ipv6Address requestedNextHopAddress, bool fromHL)
@@ -413,7 +413,7 @@ void Ipv6::routePacket(Packet *packet, const InterfaceEntry *destIE, const Inter
         }
 
         // don't forward link-local addresses or weaker
-        if ( (destAddress.isLinkLocal() || destAddress.isLoopback()) && !isAppPacket(packet) ) {
+        if ( (destAddress.isLinkLocal() || destAddress.isLoopback()) && !isAppPacket(ipv6Header) ) {
             EV_INFO << "dest address is link-local (or weaker) scope, doesn't get forwarded\n";
             delete packet;
             return;
@@ -461,6 +461,15 @@ void Ipv6::routePacket(Packet *packet, const InterfaceEntry *destIE, const Inter
     interfaceId = tunneling->getVIfIndexForDest(destAddress, Ipv6Tunneling::NORMAL);
 #endif /* WITH_xMIPv6 */
 
+    // next hop requested by a routing protocol hook takes precedence over the routing table,
+    // e.g. for RPL instances other than the one populating the routing table
+    auto nextHopReq = packet->findTag<NextHopAddressReq>();
+    auto interfaceReq = packet->findTag<InterfaceReq>();
+    if (interfaceId == -1 && nextHopReq && interfaceReq && !nextHopReq->getNextHopAddress().isUnspecified()) {
+        nextHop = nextHopReq->getNextHopAddress().toIpv6();
+        interfaceId = interfaceReq->getInterfaceId();
+    }
+
     if (interfaceId == -1 && destIE != nullptr)
         interfaceId = destIE->getInterfaceId();         // set interfaceId to destIE when not tunneling
 
@@ -537,8 +546,8 @@ void Ipv6::routeMulticastPacket(Packet *packet, const InterfaceEntry *destIE, co
     // if received from the network...
     if (fromIE != nullptr) {
         ASSERT(!fromHL);
-        // deliver locally
-        if (rt->isLocalAddress(destAddr)) {
+        // deliver locally, incl. groups joined by applications on the incoming interface
+        if (rt->isLocalAddress(destAddr) || fromIE->getProtocolData<Ipv6InterfaceData>()->isMemberOfMulticastGroup(destAddr)) {
             EV_INFO << "local delivery of multicast packet\n";
             numLocalDeliver++;
             localDeliver(packet->dup(), fromIE);
@@ -569,6 +578,16 @@ void Ipv6::routeMulticastPacket(Packet *packet, const InterfaceEntry *destIE, co
         ipv6Header = newIpv6Header;
     }
 
+    // a routing protocol hook may confine the datagram to a single interface, incl. the incoming one
+    // (e.g. RPL MOP 3 relaying to the sub-DODAG over the same radio), unspecified ID suppresses forwarding
+    if (auto interfaceReq = packet->findTag<InterfaceReq>()) {
+        if (interfaceReq->getInterfaceId() != -1)
+            fragmentPostRouting(packet, ift->getInterfaceById(interfaceReq->getInterfaceId()), MacAddress::BROADCAST_ADDRESS, fromHL);
+        else
+            delete packet;
+        return;
+    }
+
     // for now, we just send it out on every interface except on which it came. FIXME better!!!
     EV_INFO << "sending out datagram on every interface (except incoming one)\n";
     for (int i = 0; i < ift->getNumInterfaces(); i++) {
@@ -192,7 +192,11 @@ class INET_API Ipv6 : public cSimpleModule, public NetfilterBase, public Lifecyc
 
     void sendIcmpError(Packet *origPacket, Icmpv6Type type, int code);
 
-    bool isAppPacket(Packet *packet);
+    /**
+     * Application (transport layer) traffic, as opposed to control messages,
+     * determined by the upper-layer protocol of the datagram
+     */
+    bool isAppPacket(const Ptr<const Ipv6Header>& ipv6Header);
 
     // NetFilter functions:
 
@@ -0,0 +1,135 @@
+/*
+ * Simulation model for RPL (Routing Protocol for Low-Power and Lossy Networks)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *           (C) 2021  Yevhenii Shudrenko
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "DaoAckTimeoutQueue.h"
+
+namespace inet {
+
+void DaoAckTimeoutQueue::swapEntries(size_t a, size_t b)
+{
+    std::swap(heap[a], heap[b]);
+    index[heap[a].dest] = a;
+    index[heap[b].dest] = b;
+}
+
+void DaoAckTimeoutQueue::siftUp(size_t pos)
+{
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (heap[parent].deadline <= heap[pos].deadline)
+            break;
+        swapEntries(pos, parent);
+        pos = parent;
+    }
+}
+
+void DaoAckTimeoutQueue::siftDown(size_t pos)
+{
+    while (true) {
+        size_t left = 2 * pos + 1;
+        size_t right = left + 1;
+        size_t smallest = pos;
+
+        if (left < heap.size() && heap[left].deadline < heap[smallest].deadline)
+            smallest = left;
+        if (right < heap.size() && heap[right].deadline < heap[smallest].deadline)
+            smallest = right;
+        if (smallest == pos)
+            break;
+
+        swapEntries(pos, smallest);
+        pos = smallest;
+    }
+}
+
+void DaoAckTimeoutQueue::schedule(const Ipv6Address &dest, simtime_t deadline)
+{
+    auto it = index.find(dest);
+    if (it == index.end()) {
+        heap.push_back({dest, deadline, 0});
+        index[dest] = heap.size() - 1;
+        siftUp(heap.size() - 1);
+        return;
+    }
+
+    auto pos = it->second;
+    auto previousDeadline = heap[pos].deadline;
+    heap[pos].deadline = deadline;
+    if (deadline < previousDeadline)
+        siftUp(pos);
+    else
+        siftDown(pos);
+}
+
+bool DaoAckTimeoutQueue::remove(Ipv6Address dest)
+{
+    auto it = index.find(dest);
+    if (it == index.end())
+        return false;
+
+    auto pos = it->second;
+    auto last = heap.size() - 1;
+    if (pos != last)
+        swapEntries(pos, last);
+
+    heap.pop_back();
+    index.erase(dest);
+
+    if (pos < heap.size()) {
+        siftUp(pos);
+        siftDown(pos);
+    }
+    return true;
+}
+
+const DaoAckTimeoutQueue::Entry& DaoAckTimeoutQueue::top() const
+{
+    if (heap.empty())
+        throw cRuntimeError("Cannot access earliest DAO-ACK deadline, queue is empty");
+    return heap.front();
+}
+
+int DaoAckTimeoutQueue::incrementRetries(const Ipv6Address &dest)
+{
+    auto it = index.find(dest);
+    if (it == index.end())
+        return -1;
+    return heap[it->second].numRetries++;
+}
+
+simtime_t DaoAckTimeoutQueue::getDeadline(const Ipv6Address &dest) const
+{
+    auto it = index.find(dest);
+    if (it == index.end())
+        throw cRuntimeError("No pending DAO-ACK for %s", dest.str().c_str());
+    return heap[it->second].deadline;
+}
+
+std::string DaoAckTimeoutQueue::str() const
+{
+    std::ostringstream out;
+    out << heap.size() << " pending DAO-ACKs";
+    for (auto const &entry : heap)
+        out << "\n " << entry.dest << " (" << entry.numRetries << " retries), timeout at " << entry.deadline;
+    return out.str();
+}
+
+} // namespace inet
@@ -0,0 +1,99 @@
+/*
+ * Simulation model for RPL (Routing Protocol for Low-Power and Lossy Networks)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *           (C) 2021  Yevhenii Shudrenko
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _DAOACKTIMEOUTQUEUE_H
+#define _DAOACKTIMEOUTQUEUE_H
+
+#include <map>
+#include <vector>
+
+#include "inet/common/INETDefs.h"
+#include "inet/networklayer/contract/ipv6/Ipv6Address.h"
+
+namespace inet {
+
+/**
+ * Indexed binary min-heap of pending DAO-ACK deadlines, keyed by the advertised destination.
+ * Allows a single timer message per RPL module to service all outstanding DAO-ACKs,
+ * with O(log n) insert, update and removal of arbitrary entries.
+ */
+class DaoAckTimeoutQueue : public cObject
+{
+  public:
+    struct Entry {
+        Ipv6Address dest;   // destination advertised in the DAO awaiting acknowledgement
+        simtime_t deadline; // absolute DAO-ACK timeout
+        int numRetries;     // retransmissions performed so far
+    };
+
+  private:
+    std::vector<Entry> heap;
+    std::map<Ipv6Address, size_t> index; // advertised destination -> position in the heap
+
+    void swapEntries(size_t a, size_t b);
+    void siftUp(size_t pos);
+    void siftDown(size_t pos);
+
+  public:
+    DaoAckTimeoutQueue() {}
+    virtual ~DaoAckTimeoutQueue() {}
+
+    /**
+     * Insert new pending DAO-ACK or update the deadline of an existing one,
+     * preserving its retransmission counter
+     *
+     * @param dest advertised destination
+     * @param deadline absolute time of the DAO-ACK timeout
+     */
+    void schedule(const Ipv6Address &dest, simtime_t deadline);
+
+    /**
+     * Remove pending DAO-ACK entry, e.g. upon receiving corresponding DAO-ACK
+     *
+     * @return true if entry was present, false otherwise
+     */
+    bool remove(Ipv6Address dest); // by value, since reference to a heap entry is invalidated by removal
+
+    bool contains(const Ipv6Address &dest) const { return index.find(dest) != index.end(); }
+
+    /** Entry with the earliest deadline, queue must not be empty */
+    const Entry& top() const;
+
+    /**
+     * Increment retransmission counter of a pending entry
+     *
+     * @return number of retries before incrementing, -1 if no entry found
+     */
+    int incrementRetries(const Ipv6Address &dest);
+
+    /** @return deadline of a pending entry, queue must contain it */
+    simtime_t getDeadline(const Ipv6Address &dest) const;
+
+    void clear() { heap.clear(); index.clear(); }
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+
+    virtual std::string str() const override;
+};
+
+} // namespace inet
+
+#endif
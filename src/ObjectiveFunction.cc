@@ -49,16 +49,17 @@ Dio* ObjectiveFunction::getPreferredParent(std::map<Ipv6Address, Dio *> candidat
         return nullptr;
     }
 
-    EV_DETAIL << "Address - Rank" << endl;
+    EV_DETAIL << "Address - Rank (via link)" << endl;
     for (auto cp : candidateParents)
-        EV_DETAIL << cp.first << " - " << cp.second->getRank() << endl;
+        EV_DETAIL << cp.first << " - " << cp.second->getRank() << " (" << calcRank(cp.second) << ")" << endl;
 
     // Select the first entry as initial preferred parent
     Dio *newPrefParent = candidateParents.begin()->second;
-    uint16_t currentMinRank = newPrefParent->getRank();
-    // Iterate through candidate parent set and select the one with lowest rank
+    uint16_t currentMinRank = calcRank(newPrefParent);
+    // Iterate through candidate parent set and select the one yielding lowest rank,
+    // which accounts for cost of the link each candidate is reachable over
     for (std::pair<Ipv6Address, Dio *> candidate : candidateParents) {
-        uint16_t candidateParentRank = candidate.second->getRank();
+        uint16_t candidateParentRank = calcRank(candidate.second);
         if (candidateParentRank < currentMinRank) {
             currentMinRank = candidateParentRank;
             newPrefParent = candidate.second;
@@ -69,7 +70,7 @@ Dio* ObjectiveFunction::getPreferredParent(std::map<Ipv6Address, Dio *> candidat
         return newPrefParent;
 
     // Only update the parent if the rank improvement is worth it
-    if (currentPreferredParent->getRank() - newPrefParent->getRank() >= minHopRankIncrease)
+    if (calcRank(currentPreferredParent) - calcRank(newPrefParent) >= minHopRankIncrease)
         return newPrefParent;
     else
         return currentPreferredParent;
@@ -80,12 +81,12 @@ uint16_t ObjectiveFunction::calcRank(Dio* preferredParent) {
         throw cRuntimeError("Cannot calculate rank, preferredParent argument is null");
 
     uint16_t prefParentRank = preferredParent->getRank();
-    /** Calculate node's rank based on the objective function policy */
+    /** Calculate node's rank based on the objective function policy, weighted by the link cost */
     switch (type) {
         case HOP_COUNT:
-            return prefParentRank + 1;
+            return prefParentRank + preferredParent->getLinkCost();
         default:
-            return prefParentRank + DEFAULT_MIN_HOP_RANK_INCREASE;
+            return prefParentRank + DEFAULT_MIN_HOP_RANK_INCREASE * preferredParent->getLinkCost();
     }
 }
 
@@ -54,13 +54,15 @@ class ObjectiveFunction : public cObject
     /**
      * Calculate node's rank based on the chosen preferred parent [RFC 6550, 3.5].
      *
-     * @param preferredParent node's preferred parent properties (rank, address, ...)
+     * @param preferredParent node's preferred parent properties (rank, address, link cost ...)
      * represented by last DIO received from it
      * @return updated rank based on the minHopRankIncrease and OF
      */
     virtual uint16_t calcRank(Dio* preferredParent);
 
     void setMinHopRankIncrease(int incr) { minHopRankIncrease = incr; }
+    int getMinHopRankIncrease() const { return minHopRankIncrease; }
+    Ocp getType() const { return type; }
 
 };
 
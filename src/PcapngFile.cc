@@ -0,0 +1,159 @@
+/*
+ * Simulation model for RPL (Routing Protocol for Low-Power and Lossy Networks)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *           (C) 2021  Yevhenii Shudrenko
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#include "PcapngFile.h"
+
+namespace inet {
+
+/** PCAPNG block types and options, written in host byte order */
+#define PCAPNG_SECTION_HEADER_BLOCK 0x0A0D0D0A
+#define PCAPNG_INTERFACE_DESCRIPTION_BLOCK 0x00000001
+#define PCAPNG_ENHANCED_PACKET_BLOCK 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCAPNG_OPT_ENDOFOPT 0
+#define PCAPNG_OPT_IF_NAME 2
+#define PCAPNG_OPT_IF_TSRESOL 9
+#define PCAPNG_OPT_EPB_FLAGS 2
+#define PCAPNG_EPB_INBOUND 0x01
+#define PCAPNG_EPB_OUTBOUND 0x02
+#define LINKTYPE_IPV6 229
+#define TIMESTAMP_RESOLUTION_NS 9 // 10^-9 s
+
+std::map<std::string, PcapngFile *> PcapngFile::openFiles;
+
+template <typename T>
+static void append(std::vector<uint8_t>& body, T value)
+{
+    auto size = body.size();
+    body.resize(size + sizeof(T));
+    memcpy(body.data() + size, &value, sizeof(T));
+}
+
+static void appendPadded(std::vector<uint8_t>& body, const uint8_t *data, size_t length)
+{
+    body.insert(body.end(), data, data + length);
+    body.resize(body.size() + (4 - length % 4) % 4, 0);
+}
+
+static void appendOption(std::vector<uint8_t>& body, uint16_t code, const uint8_t *data, uint16_t length)
+{
+    append<uint16_t>(body, code);
+    append<uint16_t>(body, length);
+    appendPadded(body, data, length);
+}
+
+PcapngFile::PcapngFile(const std::string& fileName, int64_t maxFileSize, bool alwaysFlush) :
+    fileName(fileName),
+    numUsers(0),
+    numInterfaces(0),
+    fileSize(0),
+    maxFileSize(maxFileSize),
+    alwaysFlush(alwaysFlush)
+{
+    file = fopen(fileName.c_str(), "wb");
+    if (!file)
+        throw cRuntimeError("Cannot open capture file '%s' for writing", fileName.c_str());
+
+    std::vector<uint8_t> body;
+    append<uint32_t>(body, PCAPNG_BYTE_ORDER_MAGIC);
+    append<uint16_t>(body, 1); // major version
+    append<uint16_t>(body, 0); // minor version
+    append<int64_t>(body, -1); // section length not specified
+    writeBlock(PCAPNG_SECTION_HEADER_BLOCK, body);
+}
+
+PcapngFile::~PcapngFile()
+{
+    if (file)
+        fclose(file);
+}
+
+PcapngFile *PcapngFile::open(const std::string& fileName, int64_t maxFileSize, bool alwaysFlush)
+{
+    auto it = openFiles.find(fileName);
+    auto pcapngFile = it != openFiles.end() ? it->second : (openFiles[fileName] = new PcapngFile(fileName, maxFileSize, alwaysFlush));
+    pcapngFile->numUsers++;
+    return pcapngFile;
+}
+
+void PcapngFile::close()
+{
+    if (--numUsers > 0)
+        return;
+    openFiles.erase(fileName);
+    delete this;
+}
+
+void PcapngFile::writeBlock(uint32_t type, const std::vector<uint8_t>& body)
+{
+    uint32_t length = body.size() + 12; // type and both length fields
+    fwrite(&type, sizeof(type), 1, file);
+    fwrite(&length, sizeof(length), 1, file);
+    fwrite(body.data(), 1, body.size(), file);
+    fwrite(&length, sizeof(length), 1, file);
+    if (ferror(file))
+        throw cRuntimeError("Cannot write capture file '%s'", fileName.c_str());
+    if (alwaysFlush)
+        fflush(file);
+    fileSize += length;
+}
+
+uint32_t PcapngFile::addInterface(const std::string& name, uint32_t snaplen)
+{
+    std::vector<uint8_t> body;
+    uint8_t tsresol = TIMESTAMP_RESOLUTION_NS;
+    append<uint16_t>(body, LINKTYPE_IPV6);
+    append<uint16_t>(body, 0); // reserved
+    append<uint32_t>(body, snaplen);
+    appendOption(body, PCAPNG_OPT_IF_NAME, (const uint8_t *) name.c_str(), name.size());
+    appendOption(body, PCAPNG_OPT_IF_TSRESOL, &tsresol, sizeof(tsresol));
+    appendOption(body, PCAPNG_OPT_ENDOFOPT, nullptr, 0);
+    writeBlock(PCAPNG_INTERFACE_DESCRIPTION_BLOCK, body);
+    return numInterfaces++;
+}
+
+bool PcapngFile::writePacket(uint32_t interfaceId, int64_t timestamp, const std::vector<uint8_t>& bytes,
+        uint32_t originalLength, bool outbound)
+{
+    // fixed fields, padded data, flags and end of options
+    auto blockLength = 12 + 20 + (bytes.size() + 3) / 4 * 4 + 8 + 4;
+    if (maxFileSize > 0 && fileSize + (int64_t) blockLength > maxFileSize)
+        return false;
+
+    std::vector<uint8_t> body;
+    body.reserve(blockLength);
+    uint32_t flags = outbound ? PCAPNG_EPB_OUTBOUND : PCAPNG_EPB_INBOUND;
+    append<uint32_t>(body, interfaceId);
+    append<uint32_t>(body, (uint64_t) timestamp >> 32);
+    append<uint32_t>(body, (uint64_t) timestamp & 0xFFFFFFFF);
+    append<uint32_t>(body, bytes.size());
+    append<uint32_t>(body, originalLength);
+    appendPadded(body, bytes.data(), bytes.size());
+    appendOption(body, PCAPNG_OPT_EPB_FLAGS, (const uint8_t *) &flags, sizeof(flags));
+    appendOption(body, PCAPNG_OPT_ENDOFOPT, nullptr, 0);
+    writeBlock(PCAPNG_ENHANCED_PACKET_BLOCK, body);
+    return true;
+}
+
+} // namespace inet
+
@@ -0,0 +1,98 @@
+/*
+ * Simulation model for RPL (Routing Protocol for Low-Power and Lossy Networks)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *           (C) 2021  Yevhenii Shudrenko
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _PCAPNGFILE_H
+#define _PCAPNGFILE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "inet/common/INETDefs.h"
+
+namespace inet {
+
+/**
+ * PCAPNG capture file shared by the recorders of all nodes writing to the same path.
+ * Every node appears as a separate interface carrying raw IPv6 datagrams,
+ * blocks are streamed to disk right away and writing stops once the size limit is reached.
+ */
+class PcapngFile
+{
+  private:
+    static std::map<std::string, PcapngFile *> openFiles;
+
+    std::string fileName;
+    FILE *file;
+    int numUsers;
+    uint32_t numInterfaces;
+    int64_t fileSize;
+    int64_t maxFileSize; // 0 for unlimited
+    bool alwaysFlush;
+
+    PcapngFile(const std::string& fileName, int64_t maxFileSize, bool alwaysFlush);
+    ~PcapngFile();
+
+    void writeBlock(uint32_t type, const std::vector<uint8_t>& body);
+
+  public:
+    /**
+     * Open capture file or join the one already opened by another node
+     *
+     * @param fileName path of the capture file
+     * @param maxFileSize size limit in bytes, 0 for unlimited, taken from the first user
+     * @param alwaysFlush flush after every block, so that the capture can be followed live
+     * @return shared capture file, has to be released by @see close()
+     */
+    static PcapngFile *open(const std::string& fileName, int64_t maxFileSize, bool alwaysFlush);
+
+    /** Release capture file, closing it once the last node is done */
+    void close();
+
+    /**
+     * Add interface description for a node
+     *
+     * @param name interface name shown by Wireshark, e.g. node name
+     * @param snaplen maximum number of bytes captured per packet
+     * @return interface id to be passed to @see writePacket()
+     */
+    uint32_t addInterface(const std::string& name, uint32_t snaplen);
+
+    /**
+     * Write captured datagram as enhanced packet block
+     *
+     * @param interfaceId interface the packet was captured on
+     * @param timestamp capture time in nanoseconds
+     * @param bytes captured bytes, already truncated to snaplen
+     * @param originalLength length of the datagram before truncation
+     * @param outbound packet direction
+     * @return false if the size limit does not allow writing the packet
+     */
+    bool writePacket(uint32_t interfaceId, int64_t timestamp, const std::vector<uint8_t>& bytes,
+            uint32_t originalLength, bool outbound);
+
+    int64_t getFileSize() const { return fileSize; }
+};
+
+} // namespace inet
+
+#endif
+
@@ -27,8 +27,11 @@
 #include <regex>
 #include <math.h>
 #include "Rpl.h"
+#include "inet/networklayer/common/L3AddressResolver.h"
+#include "inet/networklayer/ipv6/Ipv6InterfaceData.h"
 #include "inet/physicallayer/contract/packetlevel/SignalTag_m.h"
 #include "inet/linklayer/ieee802154/Ieee802154MacHeader_m.h"
+#include "inet/linklayer/base/MacProtocolBase.h"
 
 namespace inet {
 
@@ -54,27 +57,37 @@ std::ostream& operator<<(std::ostream& os, std::map<Ipv6Address, std::pair<cMess
 
 Rpl::Rpl() :
     isRoot(false),
-    dodagId(Ipv6Address::UNSPECIFIED_ADDRESS),
+    instance(nullptr),
     daoDelay(DEFAULT_DAO_DELAY),
     hasStarted(false),
     daoAckTimeout(10),
     daoRtxCtn(0),
+    daoCongestionLevel(0),
+    numDaoRxInWindow(0),
     detachedTimeout(2), // manually suppressing previous DODAG info [RFC 6550, 8.2.2.1]
     daoSeqNum(0),
     prefixLength(128),
-    preferredParent(nullptr),
     objectiveFunctionType("hopCount"),
     dodagColor(cFigure::BLACK),
     pUnreachabilityDetectionEnabled(false),
     floating(false),
-    prefParentConnector(nullptr),
     numDaoDropped(0),
-    udpPacketsRecv(0),
     isLeaf(false),
     isMobile(false),
     numParentUpdates(0),
     numDaoForwarded(0),
     uplinkSlotOffset(0),
+    daoAckTimeoutEvent(nullptr),
+    daoCoalescingEvent(nullptr),
+    dtsnIncrementEvent(nullptr),
+    daoRefreshEvent(nullptr),
+    globalRepairEvent(nullptr),
+    numDisAttempts(0),
+    joinStartedAt(-1),
+    disTimeoutEvent(nullptr),
+    backboneInterface(nullptr),
+    coalescedDownlinkRequired(false),
+    coalescedUplinkRequired(false),
     apps({}),
     pJoinAtSinkAllowed(false)
 {}
@@ -82,6 +95,8 @@ Rpl::Rpl() :
 Rpl::~Rpl()
 {
     stop();
+    for (auto rplInstance : instances)
+        delete rplInstance;
 }
 
 void Rpl::initialize(int stage)
@@ -102,27 +117,63 @@ void Rpl::initialize(int stage)
             mac->subscribe("currentFrequency", this);
 
         routingTable = getModuleFromPar<Ipv6RoutingTable>(par("routingTableModule"), this);
-        trickleTimer = check_and_cast<TrickleTimer*>(getModuleByPath("^.trickleTimer"));
         daoEnabled = par("daoEnabled").boolValue();
         hostName = host->getFullName();
-        objectiveFunction = new ObjectiveFunction(par("objectiveFunctionType").stdstringValue());
-        objectiveFunction->setMinHopRankIncrease(par("minHopRankIncrease").intValue());
+        initializeInstances();
         daoRtxThresh = par("numDaoRetransmitAttempts").intValue();
         allowDodagSwitching = par("allowDodagSwitching").boolValue();
         pDaoAckEnabled = par("daoAckEnabled").boolValue();
         pUseWarmup = par("useWarmup").boolValue(); // TODO: check if still needed after IPv6 ND adjustments
         pUnreachabilityDetectionEnabled = par("unreachabilityDetectionEnabled").boolValue();
-        pShowBackupParents = par("showBackupParents").boolValue();
+        precomputedFailover = par("precomputedFailover").boolValue();
+        redirectQueuedPackets = par("redirectQueuedPackets").boolValue();
+        emitReceivedPackets = par("emitReceivedPackets").boolValue();
         pAllowDaoForwarding = par("allowDaoForwarding").boolValue();
         pJoinAtSinkAllowed = par("allowJoinAtSink").boolValue() || (uniform(0, 1) < par("joinAtSinkProbability").doubleValue());
+        daoCoalescingWindow = par("daoCoalescingWindow").doubleValue();
+        maxDaoTargets = std::max((int) ((par("maxDaoSize").intValue() - RPL_DAO_BASE_LENGTH - RPL_TRANSIT_OPTION_LENGTH)
+                / RPL_TARGET_OPTION_LENGTH), 1);
+        daoRtxBackoffCap = par("daoRtxBackoffCap").doubleValue();
+        daoCongestionHintEnabled = par("daoCongestionHintEnabled").boolValue();
+        daoCongestionThresh = std::max((int) par("daoCongestionThresh").intValue(), 1);
+        dtsnIncrementInterval = par("dtsnIncrementInterval").doubleValue();
+        daoRefreshJitter = par("daoRefreshJitter").doubleValue();
+        daoRefreshMinInterval = par("daoRefreshMinInterval").doubleValue();
+        lastDaoRefresh = -daoRefreshMinInterval; // allow answering the very first DTSN increment right away
+        globalRepairInterval = par("globalRepairInterval").doubleValue();
+        disEnabled = par("disEnabled").boolValue();
+        disJitter = par("disJitter").doubleValue();
+        disInterval = par("disInterval").doubleValue();
+        maxDisAttempts = par("maxDisAttempts").intValue();
+        if (!par("virtualDodagId").stdstringValue().empty())
+            virtualDodagId = Ipv6Address(par("virtualDodagId").stringValue());
 
         // statistic signals
         dioReceivedSignal = registerSignal("dioReceived");
         daoReceivedSignal = registerSignal("daoReceived");
+        dioReceivedPacketSignal = registerSignal("dioReceivedPacket");
+        daoReceivedPacketSignal = registerSignal("daoReceivedPacket");
         parentUnreachableSignal = registerSignal("parentUnreachable");
         parentChangedSignal = registerSignal("parentChanged");
         rankUpdatedSignal = registerSignal("rankUpdated");
         childJoinedSignal = registerSignal("childJoined");
+        daoSentSignal = registerSignal("daoSent");
+        daoBytesSentSignal = registerSignal("daoBytesSent");
+        dtsnIncrementedSignal = registerSignal("dtsnIncremented");
+        daoRefreshedSignal = registerSignal("daoRefreshed");
+        dodagVersionChangedSignal = registerSignal("dodagVersionChanged");
+        rejoinDelaySignal = registerSignal("rejoinDelay");
+        joinDelaySignal = registerSignal("joinDelay");
+        disSentSignal = registerSignal("disSent");
+        parentFailoverSignal = registerSignal("parentFailover");
+        parentFailureLossSignal = registerSignal("parentFailureLoss");
+        mcastForwardedSignal = registerSignal("mcastForwarded");
+        mcastSuppressedSignal = registerSignal("mcastSuppressed");
+        datapathLoopSignal = registerSignal("datapathLoop");
+        forwardingErrorSignal = registerSignal("forwardingError");
+        preferredParentChangedSignal = registerSignal("preferredParentChanged");
+        backupParentAddedSignal = registerSignal("backupParentAdded");
+        backupParentRemovedSignal = registerSignal("backupParentRemoved");
 
         startDelay = par("startDelay").doubleValue();
 
@@ -144,14 +195,16 @@ void Rpl::initialize(int stage)
         tschScheduleUplinkSignal = registerSignal("tschScheduleUplink");
 
         WATCH(numParentUpdates);
-        WATCH_MAP(candidateParents);
-        WATCH_MAP(backupParents);
-        WATCH_PTRMAP(pendingDaoAcks);
+        WATCH_PTRVECTOR(instances);
+        createStdMapWatcher("candidateParents", instances.front()->candidateParents);
+        createStdMapWatcher("backupParents", instances.front()->backupParents);
+        WATCH_OBJ(pendingDaoAcks);
+        WATCH(daoCongestionLevel);
 //        WATCH_OBJ(dagInfo); TODO: figure out why this doesn't work! the object IS shown in the GUI, but without any fields
         WATCH(dodagInfo.prefParent);
         WATCH(dodagInfo.prefParentRank);
         WATCH(dodagInfo.prefParentName);
-        WATCH(rank);
+        createWatch("rank", instances.front()->rank);
         WATCH(selfAddr);
         WATCH(selfId);
         WATCH(isMobile);
@@ -166,12 +219,58 @@ void Rpl::initialize(int stage)
 }
 
 void Rpl::finish() {
-    recordScalar("rank", rank);
-    if (preferredParent)
+    recordScalar("rank", instances.front()->rank);
+    if (instances.front()->preferredParent)
     {
-        recordScalar("parentId", getNodeId(dodagInfo.prefParentName));
+        // parent name is only advertised with GUI info, otherwise look up the node owning parent address
+        auto parentName = dodagInfo.prefParentName;
+        if (parentName.empty()) {
+            auto parentNode = L3AddressResolver().findHostWithAddress(dodagInfo.prefParent);
+            parentName = parentNode ? parentNode->getFullName() : "";
+        }
+        recordScalar("parentId", getNodeId(parentName));
+    }
+
+}
+
+void Rpl::initializeInstances()
+{
+    auto instanceIds = cStringTokenizer(par("instanceIds").stringValue()).asIntVector();
+    auto ofTypes = cStringTokenizer(par("objectiveFunctionTypes").stringValue()).asVector();
+    if (instanceIds.empty())
+        throw cRuntimeError("At least one RPL instance ID has to be configured");
+    if (gateSize("ttModule") != (int) instanceIds.size())
+        throw cRuntimeError("Number of connected trickle timers (%d) doesn't match number of RPL instances (%d)",
+                gateSize("ttModule"), (int) instanceIds.size());
+
+    for (size_t i = 0; i < instanceIds.size(); i++) {
+        if (findInstance(instanceIds[i]))
+            throw cRuntimeError("Duplicate RPL instance ID %d", instanceIds[i]);
+
+        auto ofType = i < ofTypes.size() ? ofTypes[i] : par("objectiveFunctionType").stdstringValue();
+        auto objectiveFunction = new ObjectiveFunction(ofType);
+        objectiveFunction->setMinHopRankIncrease(par("minHopRankIncrease").intValue());
+        auto trickleTimer = check_and_cast<TrickleTimer*>(gate("ttModule$o", i)->getPathEndGate()->getOwnerModule());
+        instances.push_back(new RplInstance(instanceIds[i], objectiveFunction, trickleTimer, i == 0));
     }
+    instance = instances.front();
 
+    // application traffic mapping in form of "<port>:<instance ID>" pairs
+    cStringTokenizer tokenizer(par("instancePorts").stringValue());
+    while (tokenizer.hasMoreTokens()) {
+        auto mapping = cStringTokenizer(tokenizer.nextToken(), ":").asIntVector();
+        if (mapping.size() != 2 || !findInstance(mapping[1]))
+            throw cRuntimeError("Invalid port to RPL instance mapping in 'instancePorts' parameter");
+        portInstances[mapping[0]] = mapping[1];
+    }
+}
+
+RplInstance* Rpl::findInstance(uint8_t instanceId)
+{
+    for (auto rplInstance : instances)
+        if (rplInstance->instanceId == instanceId)
+            return rplInstance;
+    return nullptr;
 }
 
 void Rpl::generateLayout(cModule *net) {
@@ -334,49 +433,26 @@ cFigure::Color Rpl::pickRandomColor() {
     }
 }
 
-cModule* Rpl::findSubmodule(std::string sname, cModule *host) {
-    EV_DETAIL << "Looking for module " << sname << " in " << host << endl;
-
-    for (cModule::SubmoduleIterator it(host); !it.end(); ++it) {
-        cModule *subm = *it;
-        std::string s(subm->getFullName());
-
-        if (s.find(sname) != std::string::npos)
-            return *it;
-    }
-    return nullptr;
-}
-
 //
 // Lifecycle operations
 //
 
 void Rpl::start()
 {
-    InterfaceEntry* ie = nullptr;
-
     if (startDelay > 0) {
         scheduleAt(simTime() + startDelay, new cMessage("", RPL_START));
         return;
     }
     hasStarted = true;
+    // observers subscribe during initialization, DIOs carry drawing info only if there's one
+    guiInfoEnabled = mayHaveListeners(preferredParentChangedSignal);
 
     isRoot = par("isRoot").boolValue(); // Initialization of this parameter should be here to ensure
                                         // multi-gateway configurator will have time to assign 'root' roles
                                         // to randomly chosen nodes
     position = *(new Coord());
 
-    // set network interface entry pointer (TODO: Update for IEEE 802.15.4)
-    for (int i = 0; i < interfaceTable->getNumInterfaces(); i++)
-    {
-        ie = interfaceTable->getInterface(i);
-
-        if (strstr(ie->getInterfaceName(), "wlan") != nullptr)
-        {
-            interfaceEntryPtr = ie;
-            break;
-        }
-    }
+    initializeInterfaces();
 
     selfId = interfaceTable->getInterface(1)->getMacAddress().getInt();
     mobility = check_and_cast<IMobility*> (getParentModule()->getSubmodule("mobility"));
@@ -391,48 +467,63 @@ void Rpl::start()
     for (auto i = 0; i < numApps; i++)
         apps.push_back(host->getSubmodule("app", i));
 
-    rank = INF_RANK; // TODO: was INF_RANK - 1, why?
+    for (auto rplInstance : instances)
+        rplInstance->rank = INF_RANK; // TODO: was INF_RANK - 1, why?
     detachedTimeoutEvent = new cMessage("", DETACHED_TIMEOUT);
+    daoAckTimeoutEvent = new cMessage("DAO_ACK timeout", DAO_ACK_TIMEOUT);
+    daoCoalescingEvent = new cMessage("DAO coalescing timeout", DAO_COALESCING_TIMEOUT);
+    dtsnIncrementEvent = new cMessage("DTSN increment", DTSN_INCREMENT);
+    daoRefreshEvent = new cMessage("DAO refresh", DAO_REFRESH);
+    globalRepairEvent = new cMessage("Global repair", GLOBAL_REPAIR);
+    disTimeoutEvent = new cMessage("DIS timeout", DIS_TIMEOUT);
     selfAddr = getSelfAddress();
 
     deleteManualRoutes();
 
     if (isRoot && !par("disabled").boolValue()) {
-        trickleTimer->start(pUseWarmup, par("numSkipTrickleIntervalUpdates").intValue());
         dodagColor = pickRandomColor();
-        rank = ROOT_RANK;
-        dodagVersion = DEFAULT_INIT_DODAG_VERSION;
-        instanceId = RPL_DEFAULT_INSTANCE;
-        dtsn = 0;
-        storing = par("storing").boolValue();
-        for (auto app : apps)
-            app->subscribe("packetReceived", this);
-    }
-}
-
-void Rpl::refreshDisplay() const {
-    if (preferredParent && preferredParent->isMobile() && prefParentConnector && parentMobilityMod) {
-        auto parentLoc = parentMobilityMod->getCurrentPosition();
-        prefParentConnector->setEnd(cFigure::Point(parentLoc.x, parentLoc.y));
+        // sink roots a DODAG of every configured instance
+        for (auto rplInstance : instances) {
+            rplInstance->trickleTimer->start(pUseWarmup, par("numSkipTrickleIntervalUpdates").intValue());
+            rplInstance->rank = ROOT_RANK;
+            rplInstance->dodagVersion = DEFAULT_INIT_DODAG_VERSION;
+            rplInstance->dtsn = 0;
+            rplInstance->storing = par("storing").boolValue();
+            rplInstance->multicast = rplInstance->storing && par("multicast").boolValue();
+        }
+        if (!virtualDodagId.isUnspecified())
+            initializeVirtualRoot();
     }
 
-    if (isMobile && prefParentConnector) {
-        auto currentCoord = mobility->getCurrentPosition();
-        prefParentConnector->setStart(cFigure::Point(currentCoord.x, currentCoord.y));
+    if (dtsnIncrementInterval > 0 && (isRoot || par("routerDtsnIncrement").boolValue()))
+        scheduleAt(simTime() + dtsnIncrementInterval, dtsnIncrementEvent);
 
-        if (!preferredParent)
-            prefParentConnector->setEnd(cFigure::Point(currentCoord.x, currentCoord.y));
-    }
+    if (isRoot && globalRepairInterval > 0)
+        scheduleAt(simTime() + globalRepairInterval, globalRepairEvent);
 
-    if (isRoot) {
-        host->getDisplayString().setTagArg("t", 0, std::string(" num rcvd: " + std::to_string(udpPacketsRecv)).c_str());
-        host->getDisplayString().setTagArg("t", 1, "l"); // set display text position to 'left'
+    if (!isRoot) {
+        joinStartedAt = simTime();
+        scheduleDis(0);
     }
 }
 
 void Rpl::stop()
 {
     cancelAndDelete(detachedTimeoutEvent);
+    cancelAndDelete(daoAckTimeoutEvent);
+    cancelAndDelete(daoCoalescingEvent);
+    cancelAndDelete(dtsnIncrementEvent);
+    cancelAndDelete(daoRefreshEvent);
+    cancelAndDelete(globalRepairEvent);
+    cancelAndDelete(disTimeoutEvent);
+    daoAckTimeoutEvent = nullptr;
+    daoCoalescingEvent = nullptr;
+    dtsnIncrementEvent = nullptr;
+    daoRefreshEvent = nullptr;
+    globalRepairEvent = nullptr;
+    disTimeoutEvent = nullptr;
+    pendingDaoAcks.clear();
+    coalescedDaoTargets.clear();
 }
 
 void Rpl::handleMessageWhenUp(cMessage *message)
@@ -446,6 +537,9 @@ void Rpl::handleMessageWhenUp(cMessage *message)
 
 void Rpl::processSelfMessage(cMessage *message)
 {
+    // node-wide timers (DAO-ACK, aggregation, DTSN, DIS, detachment) are maintained for the primary instance
+    instance = instances.front();
+
     switch (message->getKind()) {
         case DETACHED_TIMEOUT: {
             floating = false;
@@ -458,12 +552,30 @@ void Rpl::processSelfMessage(cMessage *message)
             break;
         }
         case DAO_ACK_TIMEOUT: {
-            Ipv6Address *advDest = (Ipv6Address*) message->getContextPointer();
-            if (pendingDaoAcks.find(*advDest) == pendingDaoAcks.end())
-                EV_WARN << "Received DAO_ACK timeout for deleted entry, ignoring" << endl;
-            else
-                retransmitDao(*advDest);
-            break;
+            // timer is reused for all pending DAO_ACKs, hence not deleted
+            processDaoAckTimeout();
+            return;
+        }
+        case DAO_COALESCING_TIMEOUT: {
+            flushCoalescedDaoTargets();
+            return;
+        }
+        case DTSN_INCREMENT: {
+            processDtsnIncrementTimer();
+            return;
+        }
+        case DAO_REFRESH: {
+            sendDaoRefresh();
+            return;
+        }
+        case DIS_TIMEOUT: {
+            sendDis();
+            return;
+        }
+        case GLOBAL_REPAIR: {
+            globalRepair();
+            scheduleAt(simTime() + globalRepairInterval, globalRepairEvent);
+            return;
         }
         default: EV_WARN << "Unknown self-message received - " << message << endl;
     }
@@ -471,31 +583,64 @@ void Rpl::processSelfMessage(cMessage *message)
 }
 
 void Rpl::clearDaoAckTimer(Ipv6Address daoDest) {
-    if (pendingDaoAcks.count(daoDest))
-        if (pendingDaoAcks[daoDest]->timeoutPtr && pendingDaoAcks[daoDest]->timeoutPtr->isSelfMessage())
-            cancelEvent(pendingDaoAcks[daoDest]->timeoutPtr);
-    pendingDaoAcks.erase(daoDest);
+    if (pendingDaoAcks.remove(daoDest))
+        updateDaoAckTimer();
 }
 
 void Rpl::clearAllDaoAckTimers() {
-    for (auto t: pendingDaoAcks)
-        if (t.second->timeoutPtr && t.second->timeoutPtr->isSelfMessage())
-            cancelEvent(t.second->timeoutPtr);
+    pendingDaoAcks.clear();
+    daoAckTargets.clear();
+    updateDaoAckTimer();
+}
+
+void Rpl::updateDaoAckTimer() {
+    if (!daoAckTimeoutEvent)
+        return;
+
+    if (pendingDaoAcks.empty()) {
+        cancelEvent(daoAckTimeoutEvent);
+        return;
+    }
+
+    auto nextDeadline = pendingDaoAcks.top().deadline;
+    if (daoAckTimeoutEvent->isScheduled()) {
+        if (daoAckTimeoutEvent->getArrivalTime() == nextDeadline)
+            return;
+        cancelEvent(daoAckTimeoutEvent);
+    }
+    scheduleAt(std::max(nextDeadline, simTime()), daoAckTimeoutEvent);
+}
+
+void Rpl::processDaoAckTimeout() {
+    std::vector<Ipv6Address> expiredDests;
+    while (!pendingDaoAcks.empty() && pendingDaoAcks.top().deadline <= simTime()) {
+        auto dest = pendingDaoAcks.top().dest;
+        expiredDests.push_back(dest);
+        // provisionally moved out of the way, retransmitDao() either reschedules the entry or erases it
+        pendingDaoAcks.schedule(dest, simTime() + DAO_ACK_MIN_TIMEOUT);
+    }
+
+    for (auto const &dest : expiredDests) {
+        retransmitDao(dest);
+        // with zero timeout and delay retransmission would expire right away again
+        if (pendingDaoAcks.contains(dest) && pendingDaoAcks.getDeadline(dest) <= simTime())
+            pendingDaoAcks.schedule(dest, simTime() + DAO_ACK_MIN_TIMEOUT);
+    }
 
-    pendingDaoAcks.erase(pendingDaoAcks.begin(), pendingDaoAcks.end());
+    updateDaoAckTimer();
 }
 
 void Rpl::retransmitDao(Ipv6Address advDest) {
     EV_DETAIL << "DAO_ACK for " << advDest << " timed out, attempting retransmit" << endl;
 
-    if (!preferredParent) {
+    if (!instance->preferredParent) {
         EV_WARN << "Preferred parent not set, cannot retransmit DAO"
                 << "erasing entry from pendingDaoAcks " << endl;
         clearDaoAckTimer(advDest);
         return;
     }
 
-    auto rtxCtn = pendingDaoAcks[advDest]->numRetries++;
+    auto rtxCtn = pendingDaoAcks.incrementRetries(advDest);
     if (rtxCtn > daoRtxThresh) {
         EV_DETAIL << "Retransmission threshold (" << std::to_string(daoRtxThresh)
             << ") exceeded, erasing corresponding entry from pending ACKs" << endl;
@@ -504,9 +649,154 @@ void Rpl::retransmitDao(Ipv6Address advDest) {
         return;
     }
 
-    EV_DETAIL << "(" << std::to_string(rtxCtn) << " attempt)" << endl;
+    auto backoff = getDaoRtxBackoff(rtxCtn);
+    EV_DETAIL << "(" << std::to_string(rtxCtn) << " attempt), backoff " << backoff << "s" << endl;
+
+    sendRplPacket(createDao(advDest), DAO, instance->preferredParent->getSrcAddress(), backoff);
+}
+
+double Rpl::getDaoRtxBackoff(int numRetries)
+{
+    // limit the shift, cap is reached long before anyway
+    auto backoff = std::min(daoRtxBackoffCap, daoDelay * (1 << std::min(numRetries, 16)));
+    backoff = std::min(daoRtxBackoffCap, backoff * (1 + getDaoCongestionLevel()));
+
+    // jitter over the upper half of the window to de-synchronize retries after DODAG-wide events
+    return uniform(backoff / 2, backoff);
+}
+
+uint8_t Rpl::getDaoCongestionLevel()
+{
+    if (!daoCongestionHintEnabled || isRoot)
+        return daoCongestionLevel;
+
+    auto numHalvings = (int) ((simTime() - daoCongestionLevelUpdatedAt).dbl() / daoAckTimeout);
+    return numHalvings >= 8 ? 0 : daoCongestionLevel >> numHalvings;
+}
+
+void Rpl::updateDaoCongestionLevel()
+{
+    if (simTime() - daoRxWindowStart >= daoAckTimeout) {
+        daoCongestionLevel = std::min(numDaoRxInWindow / daoCongestionThresh, MAX_DAO_CONGESTION_LEVEL);
+        numDaoRxInWindow = 0;
+        daoRxWindowStart = simTime();
+    }
+    numDaoRxInWindow++;
+
+    // react to the load building up within the current window as well
+    daoCongestionLevel = std::max((int) daoCongestionLevel,
+            std::min(numDaoRxInWindow / daoCongestionThresh, MAX_DAO_CONGESTION_LEVEL));
+}
+
+void Rpl::refreshDownwardRoutes()
+{
+    Enter_Method_Silent("refreshDownwardRoutes()");
+
+    // DAO refresh is node-wide and serves the primary instance only,
+    // hence don't rely on whichever instance was processed last
+    auto primary = instances.front();
+    primary->dtsn = lollipopIncrement(primary->dtsn);
+    emit(dtsnIncrementedSignal, (long) primary->dtsn);
+    EV_DETAIL << "DTSN of RPL instance " << (int) primary->instanceId
+            << " incremented to " << (int) primary->dtsn << endl;
+
+    if (primary->trickleTimer->hasStarted())
+        primary->trickleTimer->reset(TRICKLE_RESET_DTSN_INCREMENTED);
+}
+
+void Rpl::globalRepair()
+{
+    Enter_Method_Silent("globalRepair()");
+
+    if (!isRoot) {
+        EV_WARN << "Only DODAG root may initiate global repair" << endl;
+        return;
+    }
+
+    for (auto rplInstance : instances) {
+        rplInstance->dodagVersion = lollipopIncrement(rplInstance->dodagVersion);
+        emit(dodagVersionChangedSignal, (long) rplInstance->dodagVersion);
+        EV_DETAIL << "Global repair of RPL instance " << (int) rplInstance->instanceId
+                << ", DODAG version incremented to " << (int) rplInstance->dodagVersion << endl;
+
+        if (rplInstance->trickleTimer->hasStarted())
+            rplInstance->trickleTimer->reset(TRICKLE_RESET_VERSION_CHANGED);
+    }
+}
+
+void Rpl::joinNewDodagVersion(const Ptr<const Dio>& dio)
+{
+    EV_DETAIL << "New DODAG version " << (int) dio->getDodagVersion() << " advertised by "
+            << dio->getSrcAddress() << ", dropping state of version " << (int) instance->dodagVersion << endl;
+
+    /**
+     * Neighbors still in the old version may have a rank higher than
+     * ours in the new one, so none of them is eligible as a parent anymore.
+     * DAO routes are kept, they're overwritten once sub-DODAG re-advertises itself
+     */
+    clearParentRoutes();
+    clearAllDaoAckTimers();
+    eraseBackupParentList(instance->backupParents);
+    instance->candidateParents.clear();
+    delete instance->preferredParent;
+    instance->preferredParent = nullptr;
+    delete instance->failoverParent;
+    instance->failoverParent = nullptr;
+    emitParentSetChange(preferredParentChangedSignal, nullptr);
+    instance->rank = INF_RANK;
+
+    instance->dodagVersion = dio->getDodagVersion();
+    instance->dtsn = dio->getDtsn();
+    instance->versionChangedAt = simTime();
+    emit(dodagVersionChangedSignal, (long) instance->dodagVersion);
+
+    if (instance->trickleTimer->hasStarted())
+        instance->trickleTimer->reset(TRICKLE_RESET_VERSION_CHANGED);
+}
+
+void Rpl::processDtsnIncrementTimer()
+{
+    // routers only refresh their sub-DODAG while attached
+    if (isRoot || (instance->storing && instance->preferredParent))
+        refreshDownwardRoutes();
+
+    scheduleAt(simTime() + dtsnIncrementInterval, dtsnIncrementEvent);
+}
+
+void Rpl::scheduleDaoRefresh()
+{
+    // pending refresh covers any further increments, which limits the DAO storm,
+    // refresh timer is node-wide and thus serves the primary instance
+    if (!daoEnabled || !instance->isPrimary() || daoRefreshEvent->isScheduled())
+        return;
+
+    auto refreshAt = std::max(simTime(), lastDaoRefresh + daoRefreshMinInterval) + uniform(0, daoRefreshJitter);
+    scheduleAt(refreshAt, daoRefreshEvent);
+
+    // in storing mode routes of the sub-DODAG are kept here, hence ask it to refresh them as well
+    if (instance->storing)
+        refreshDownwardRoutes();
+}
+
+void Rpl::sendDaoRefresh()
+{
+    if (!instance->preferredParent) {
+        EV_DETAIL << "Preferred parent lost before DAO refresh, skipping" << endl;
+        return;
+    }
+
+    auto prefParentAddr = instance->preferredParent->getSrcAddress();
+    lastDaoRefresh = simTime();
+
+    if (instance->storing) {
+        for (auto dao : createDaos(getOwnTargets()))
+            sendRplPacket(dao, DAO, prefParentAddr, 0);
+    }
+    else
+        sendRplPacket(createDao(), DAO, prefParentAddr, 0, getSelfAddress(), prefParentAddr);
 
-    sendRplPacket(createDao(advDest), DAO, preferredParent->getSrcAddress(), daoDelay);
+    emit(daoRefreshedSignal, 1L);
+    EV_DETAIL << "Sent DAO refresh to pref. parent - " << prefParentAddr << endl;
 }
 
 void Rpl::detachFromDodag() {
@@ -515,16 +805,22 @@ void Rpl::detachFromDodag() {
      * with a DODAG and should suppress previous RPL state info by
      * clearing dodagId, neighbor sets and setting it's rank to INFINITE_RANK [RFC6560, 8.2.2.1]
      */
-    eraseBackupParentList(backupParents);
+    // former siblings are the most likely parents to rejoin through, solicit DIOs from them directly
+    disUnicastTargets.clear();
+    for (auto const &bp : instance->backupParents)
+        disUnicastTargets.push_back(bp.first);
+    eraseBackupParentList(instance->backupParents);
 
     /** Delete all routes associated with DAO destinations of the former DODAG */
     purgeDaoRoutes();
     clearAllDaoAckTimers();
-    rank = INF_RANK;
-    trickleTimer->suspend(); // TODO: re-think this part of TT lifecycle, possibly replace with stop
+    delete instance->failoverParent;
+    instance->failoverParent = nullptr;
+    instance->rank = INF_RANK;
+    instance->trickleTimer->suspend(); // TODO: re-think this part of TT lifecycle, possibly replace with stop
     if (par("poisoning").boolValue())
         poisonSubDodag();
-    dodagId = Ipv6Address::UNSPECIFIED_ADDRESS;
+    instance->dodagId = Ipv6Address::UNSPECIFIED_ADDRESS;
     floating = true;
     EV_DETAIL << "Detached state enabled, no RPL packets will be processed for "
             << (int)detachedTimeout << "s" << endl;
@@ -533,9 +829,48 @@ void Rpl::detachFromDodag() {
         cancelEvent(detachedTimeoutEvent);
     else
         detachedTimeoutEvent = new cMessage("Detachment from DODAG timeout", DETACHED_TIMEOUT);
-    if (!isMobile)
-        drawConnector(position, cFigure::BLACK);
+    emitParentSetChange(preferredParentChangedSignal, nullptr);
     scheduleAt(simTime() + detachedTimeout, detachedTimeoutEvent);
+
+    // DIOs received while floating are discarded, hence solicit them only afterwards
+    joinStartedAt = simTime();
+    scheduleDis(detachedTimeout);
+}
+
+void Rpl::scheduleDis(double delay)
+{
+    if (!disEnabled || !disTimeoutEvent)
+        return;
+
+    numDisAttempts = 0;
+    cancelEvent(disTimeoutEvent);
+    scheduleAt(simTime() + delay + uniform(0, disJitter), disTimeoutEvent);
+}
+
+void Rpl::sendDis()
+{
+    if (instance->preferredParent || numDisAttempts >= maxDisAttempts) {
+        disUnicastTargets.clear();
+        return;
+    }
+    numDisAttempts++;
+
+    if (disUnicastTargets.empty()) {
+        EV_DETAIL << "Sending multicast DIS, attempt " << numDisAttempts << endl;
+        multicastRplPacket(createDis(), DIS, 0);
+        emit(disSentSignal, 1L);
+    }
+    else {
+        // unicast solicitation is attempted once, multicast afterwards
+        for (auto const &neighborAddr : disUnicastTargets) {
+            EV_DETAIL << "Sending unicast DIS to " << neighborAddr << endl;
+            sendRplPacket(createDis(), DIS, neighborAddr, 0);
+            emit(disSentSignal, 1L);
+        }
+        disUnicastTargets.clear();
+    }
+
+    scheduleAt(simTime() + disInterval, disTimeoutEvent);
 }
 
 void Rpl::eraseBackupParentList(map <Ipv6Address, Dio*> &backupParents) {
@@ -543,17 +878,19 @@ void Rpl::eraseBackupParentList(map <Ipv6Address, Dio*> &backupParents) {
     if (!backupParents.size())
         return;
 
-    // First clear any drawn connector lines
-    cCanvas *canvas = getParentModule()->getParentModule()->getCanvas();
-    for (auto entry : backupConnectors)
-        canvas->removeFigure(entry.second);
-
-    backupConnectors.erase(backupConnectors.begin(), backupConnectors.end());
+    for (auto entry : backupParents)
+        emitParentSetChange(backupParentRemovedSignal, entry.second);
     backupParents.erase(backupParents.begin(), backupParents.end());
     EV_DETAIL << "Backup parents list erased" << endl;
 }
 
 void Rpl::purgeDaoRoutes() {
+    if (!instance->isPrimary()) {
+        instance->downwardRoutes.clear();
+        instance->downwardPathSequences.clear();
+        return;
+    }
+
     if (!routingTable) {
         EV_WARN << "No routing table module found, can't purge routes learned from DAOs" << endl;
         return;
@@ -565,7 +902,7 @@ void Rpl::purgeDaoRoutes() {
     for (int i = 0; i < numRoutes; i++) {
         auto ri = routingTable->getRoute(i);
         auto routeData = dynamic_cast<RplRouteData *> (ri->getProtocolData());
-        if (routeData && routeData->getDodagId() == dodagId && routeData->getInstanceId() == instanceId)
+        if (routeData && routeData->getDodagId() == instance->dodagId && routeData->getInstanceId() == instance->instanceId)
             purgedRoutes.push_front(ri);
     }
     if (!purgedRoutes.empty()) {
@@ -577,9 +914,9 @@ void Rpl::purgeDaoRoutes() {
 }
 
 void Rpl::poisonSubDodag() {
-    ASSERT(rank == INF_RANK);
+    ASSERT(instance->rank == INF_RANK);
     EV_DETAIL << "Poisoning sub-dodag by advertising INF_RANK " << endl;
-    sendRplPacket(createDio(), DIO, Ipv6Address::ALL_NODES_1, uniform(1, 2));
+    multicastDio(uniform(1, 2));
 }
 
 //
@@ -609,16 +946,17 @@ void Rpl::processTrickleTimerMsg(cMessage *message)
      * Process signal from trickle timer module,
      * indicating DIO broadcast event [RFC6560, 8.3]
      */
-    EV_DETAIL << "Processing msg from trickle timer" << endl;
+    instance = instances.at(message->getArrivalGate()->getIndex());
+    EV_DETAIL << "Processing msg from trickle timer of RPL instance " << (int) instance->instanceId << endl;
     switch (message->getKind()) {
         case TRICKLE_TRIGGER_EVENT: {
             /**
              * Broadcast DIO only if number of DIOs heard
              * from other nodes <= redundancyConstant (k) [RFC6206, 4.2]
              */
-            if (trickleTimer->checkRedundancyConst()) {
+            if (instance->trickleTimer->checkRedundancyConst()) {
                 EV_DETAIL << "Redundancy OK, broadcasting DIO" << endl;
-               sendRplPacket(createDio(), DIO, Ipv6Address::ALL_NODES_1, uniform(0, 1));
+               multicastDio(uniform(0, 1));
                 // sendRplPacket(createDio(), DIO, Ipv6Address::ALL_NODES_1, 0); // avoid randomness for topology evaluation scenarios with 6TiSCH
             }
             break;
@@ -629,8 +967,8 @@ void Rpl::processTrickleTimerMsg(cMessage *message)
 }
 
 bool Rpl::isRplPacket(Packet *packet) {
-    auto fullname = std::string(packet->getFullName());
-    return !(fullname.find("DIO") == std::string::npos && fullname.find("DAO") == std::string::npos);
+    auto protocolTag = packet->findTag<PacketProtocolTag>();
+    return protocolTag && protocolTag->getProtocol() == &Protocol::manet;
 }
 
 void Rpl::processPacket(Packet *packet)
@@ -652,11 +990,53 @@ void Rpl::processPacket(Packet *packet)
         return;
     }
 
+    // roots of a virtual DODAG only exchange downward routes over the backbone
+    auto interfaceInd = packet->findTag<InterfaceInd>();
+    if (backboneInterface && interfaceInd && interfaceInd->getInterfaceId() == backboneInterface->getInterfaceId()) {
+        if (rplHeader->getIcmpv6Code() == DAO) {
+            instance = instances.front();
+            processBackboneDao(packet->peekData<Dao>(), packet->getTag<L3AddressInd>()->getSrcAddress().toIpv6());
+        }
+        delete packet;
+        return;
+    }
+
+    if (interfaceInd) {
+        if (!isRplInterface(interfaceInd->getInterfaceId())) {
+            EV_DETAIL << "RPL is not enabled on the arrival interface, discarding " << packet << endl;
+            delete packet;
+            return;
+        }
+        neighborInterfaces[packet->getTag<L3AddressInd>()->getSrcAddress().toIpv6()] = interfaceInd->getInterfaceId();
+    }
+
+    /**
+     * Dispatch control packet to the RPL instance it belongs to,
+     * DIS solicits DIOs of every instance the node participates in
+     */
+    if (rplHeader->getIcmpv6Code() == DIS) {
+        auto dis = packet->peekData<Dis>();
+        for (auto rplInstance : instances) {
+            instance = rplInstance;
+            processDis(dis, packet->getTag<L3AddressInd>()->getDestAddress());
+        }
+        delete packet;
+        return;
+    }
+
+    instance = findInstance(peekRplBody(packet, rplHeader->getIcmpv6Code())->getInstanceId());
+    if (!instance) {
+        EV_DETAIL << "Packet belongs to an RPL instance not configured on this node, discarding" << endl;
+        instance = instances.front();
+        delete packet;
+        return;
+    }
+
     // in non-storing mode check for RPL Target, Transit Information options
-    if (!storing && dodagId != Ipv6Address::UNSPECIFIED_ADDRESS)
+    if (!instance->storing && instance->dodagId != Ipv6Address::UNSPECIFIED_ADDRESS)
         extractSourceRoutingData(packet);
 
-    auto rplBody = packet->peekData<RplPacket>();
+    auto rplBody = peekRplBody(packet, rplHeader->getIcmpv6Code());
     switch (rplHeader->getIcmpv6Code()) {
         case DIO: {
             processDio(dynamicPtrCast<const Dio>(rplBody));
@@ -676,6 +1056,17 @@ void Rpl::processPacket(Packet *packet)
     delete packet;
 }
 
+const Ptr<const RplPacket> Rpl::peekRplBody(Packet *packet, RplPacketCode code)
+{
+    switch (code) {
+        case DIO: return packet->peekAtFront<Dio>();
+        case DAO: return packet->peekAtFront<Dao>();
+        case DAO_ACK: return packet->peekAtFront<DaoAck>();
+        case DIS: return packet->peekAtFront<Dis>();
+        default: return packet->peekAtFront<RplPacket>();
+    }
+}
+
 int Rpl::getNumDownlinks() {
     EV_DETAIL << "Calculating number of downlinks" << endl;
     auto numRts = routingTable->getNumRoutes();
@@ -707,96 +1098,129 @@ void Rpl::sendPacket(cPacket *packet, double delay)
 // Handling RPL packets
 //
 
-void Rpl::sendRplPacket(const Ptr<RplPacket>& body, RplPacketCode code,
+void Rpl::sendRplPacket(const Ptr<const RplPacket>& body, RplPacketCode code,
         const L3Address& nextHop, double delay, std::string interfaceName)
 {
     sendRplPacket(body, code, nextHop, delay, Ipv6Address::UNSPECIFIED_ADDRESS, Ipv6Address::UNSPECIFIED_ADDRESS, interfaceName);
 }
 
-void Rpl::sendRplPacket(const Ptr<RplPacket>& body, RplPacketCode code,
+void Rpl::sendRplPacket(const Ptr<const RplPacket>& body, RplPacketCode code,
         const L3Address& nextHop, double delay)
 {
-    sendRplPacket(body, code, nextHop, delay, Ipv6Address::UNSPECIFIED_ADDRESS, Ipv6Address::UNSPECIFIED_ADDRESS, "wlan0");
+    sendRplPacket(body, code, nextHop, delay, Ipv6Address::UNSPECIFIED_ADDRESS, Ipv6Address::UNSPECIFIED_ADDRESS, "");
 }
 
-void Rpl::sendRplPacket(const Ptr<RplPacket> &body, RplPacketCode code,
+void Rpl::sendRplPacket(const Ptr<const RplPacket>& body, RplPacketCode code,
         const L3Address& nextHop, double delay, const Ipv6Address &target, const Ipv6Address &transit, std::string interfaceName)
 {
     Packet *pkt = new Packet(std::string("inet::RplPacket::" + rplIcmpCodeToStr(code)).c_str());
 
     auto header = makeShared<RplHeader>();
+    header->setChunkLength(B(RPL_HEADER_LENGTH));
     header->setIcmpv6Code(code);
     pkt->addTag<PacketProtocolTag>()->setProtocol(&Protocol::manet);
     pkt->addTag<DispatchProtocolReq>()->setProtocol(&Protocol::ipv6);
 
+    auto outIe = interfaceName.empty() ? getInterfaceTowards(nextHop.toIpv6()) : interfaceTable->findInterfaceByName(interfaceName.c_str());
+    if (!outIe)
+        throw cRuntimeError("Cannot send %s, no interface '%s' found", rplIcmpCodeToStr(code).c_str(), interfaceName.c_str());
+
+    // backbone traffic is sent from the link-local address of the backbone interface,
+    // so that peer roots can resolve it as the next hop of the shared routes
+    bool onBackbone = outIe == backboneInterface;
+    auto srcAddr = onBackbone ? outIe->getProtocolData<Ipv6InterfaceData>()->getLinkLocalAddress() : outIe->getNetworkAddress().toIpv6();
+    auto nodeId = outIe->getMacAddress().getInt();
+    auto sentBody = body;
+    if (!onBackbone && (body->getSrcAddress() != srcAddr || body->getNodeId() != nodeId)) {
+        // neighbors address this node by the interface they hear it on,
+        // bodies already sent out (shared and immutable) are copied
+        auto updatedBody = body->isMutable() ? constPtrCast<RplPacket>(body) : staticPtrCast<RplPacket>(body->dupShared());
+        updatedBody->setSrcAddress(srcAddr);
+        updatedBody->setNodeId(nodeId);
+        sentBody = updatedBody;
+    }
     auto addresses = pkt->addTag<L3AddressReq>();
-    addresses->setSrcAddress(getSelfAddress());
+    addresses->setSrcAddress(srcAddr);
     addresses->setDestAddress(nextHop);
+    // unicast follows the route towards the next hop, multicast has to be bound to an interface
+    if (nextHop.isMulticast())
+        pkt->addTag<InterfaceReq>()->setInterfaceId(outIe->getInterfaceId());
+    // append RPL Target + Transit option headers if corresponding addresses were provided (non-storing mode),
+    // they replace DAO's own options, so that the message carries a single Transit option with parent address
+    bool appendTransitOptions = target != Ipv6Address::UNSPECIFIED_ADDRESS && transit != Ipv6Address::UNSPECIFIED_ADDRESS;
+    if (code == DAO && appendTransitOptions) {
+        auto dao = staticPtrCast<Dao>(sentBody->isMutable() ? constPtrCast<RplPacket>(sentBody) : staticPtrCast<RplPacket>(sentBody->dupShared()));
+        dao->setTransitOptionsAppended(true);
+        dao->setChunkLength(getDaoLength(dao.get()));
+        sentBody = dao;
+    }
     pkt->insertAtFront(header);
-    pkt->insertAtBack(body);
-    // append RPL Target + Transit option headers if corresponding addresses were provided (non-storing mode)
-    if (target != Ipv6Address::UNSPECIFIED_ADDRESS && transit != Ipv6Address::UNSPECIFIED_ADDRESS)
+    pkt->insertAtBack(sentBody);
+    if (appendTransitOptions)
         appendDaoTransitOptions(pkt, target, transit);
 
-    if (code == DAO && ((dynamicPtrCast<Dao>) (body))->getDaoAckRequired()) {
-        auto outgoingDao = (dynamicPtrCast<Dao>) (body);
-        auto advertisedDest = outgoingDao->getReachableDest();
-        auto timeout = simTime() + SimTime(daoAckTimeout, SIMTIME_S) * uniform(3, 4); // TODO: Magic numbers
-
-        EV_DETAIL << "Scheduling DAO_ACK timeout at " << timeout << " for advertised dest "
-                << advertisedDest << endl;
+    if (code == DAO && !onBackbone) {
+        emit(daoSentSignal, (long) (dynamicPtrCast<const Dao>(body))->getKnownTargetsArraySize() + 1);
+        emit(daoBytesSentSignal, (long) (pkt->getByteLength() - RPL_HEADER_LENGTH));
+    }
 
-        cMessage *daoTimeoutMsg = new cMessage("", DAO_ACK_TIMEOUT);
-        daoTimeoutMsg->setContextPointer(new Ipv6Address(advertisedDest));
-        EV_DEBUG << "Created DAO_ACK timeout msg with context pointer - "
-                << *((Ipv6Address *) daoTimeoutMsg->getContextPointer()) << endl;
+    if (code == DAO && ((dynamicPtrCast<const Dao>) (body))->getDaoAckRequired()) {
+        auto outgoingDao = (dynamicPtrCast<const Dao>) (body);
+        // account for the send delay, otherwise long backoffs expire before DAO even leaves the node
+        auto timeout = simTime() + delay + SimTime(daoAckTimeout, SIMTIME_S) * uniform(3, 4); // TODO: Magic numbers
+        // DAO-ACK only echoes the sequence number, remember what it's going to acknowledge
+        daoAckTargets[outgoingDao->getSeqNum()] = getDaoTargets(outgoingDao.get());
 
-        auto daoAckEntry = pendingDaoAcks.find(advertisedDest);
-        if (daoAckEntry != pendingDaoAcks.end()) {
+        for (auto advertisedDest : getDaoTargets(outgoingDao.get())) {
+            EV_DETAIL << "Scheduling DAO_ACK timeout at " << timeout << " for advertised dest "
+                    << advertisedDest << endl;
 
-            if (pendingDaoAcks[advertisedDest]->timeoutPtr)
-                cancelEvent(pendingDaoAcks[advertisedDest]->timeoutPtr);
+            if (pendingDaoAcks.contains(advertisedDest))
+                EV_DETAIL << "Found existing entry in pending DAO_ACKs for dest - " << advertisedDest
+                        << " updating timeout" << endl;
 
-            pendingDaoAcks[advertisedDest]->timeoutPtr = daoTimeoutMsg;
-            EV_DETAIL << "Found existing entry in DAO_ACKs map for dest - " << advertisedDest
-                    << " updating timeout event ptr" << endl;
-        }
-        else {
-            pendingDaoAcks[advertisedDest] = new DaoTimeoutInfo(daoTimeoutMsg);
+            pendingDaoAcks.schedule(advertisedDest, timeout);
         }
+        updateDaoAckTimer();
 
-        EV_DETAIL << "Pending DAO_ACKs:" << endl;
-        for (auto e : pendingDaoAcks)
-            EV_DETAIL << e.first << " (" << std::to_string(e.second->numRetries) << " attempts), timeout msg ptr - " << e.second->timeoutPtr << endl;
-
-        scheduleAt(timeout, pendingDaoAcks[advertisedDest]->timeoutPtr);
+        EV_DETAIL << pendingDaoAcks.str() << endl;
     }
     sendPacket(pkt, delay);
 
 }
 
+void Rpl::multicastRplPacket(const Ptr<const RplPacket>& body, RplPacketCode code, double delay)
+{
+    for (auto ie : rplInterfaces)
+        sendRplPacket(body, code, Ipv6Address::ALL_NODES_1, delay, ie->getInterfaceName());
+}
+
 const Ptr<Dio> Rpl::createDio()
 {
-    auto ourMacAddr = interfaceTable->getInterface(1)->getMacAddress();
-    selfId = interfaceTable->getInterface(1)->getMacAddress().getInt();
     auto dio = makeShared<Dio>();
-    dio->setInstanceId(instanceId);
+    dio->setInstanceId(instance->instanceId);
     dio->setChunkLength(getDioSize());
-    dio->setStoring(storing);
-    dio->setRank(rank);
-    dio->setDtsn(dtsn);
+    dio->setMinInterval(instance->trickleTimer->getMinInterval());
+    dio->setDioRedundancyConst(instance->trickleTimer->getRedundancyConst());
+    dio->setDioNumDoublings(instance->trickleTimer->getNumDoublings());
+    dio->setOcp(instance->objectiveFunction->getType());
+    dio->setMinHopRankIncrease(instance->objectiveFunction->getMinHopRankIncrease());
+    dio->setStoring(instance->storing);
+    dio->setMop(getAdvertisedMop());
+    dio->setRank(instance->rank);
+    dio->setDtsn(instance->dtsn);
     dio->setNodeId(selfId);
-    dio->setDodagVersion(dodagVersion);
-    dio->setDodagId(isRoot ? getSelfAddress() : dodagId);
+    dio->setDodagVersion(instance->dodagVersion);
+    dio->setDodagId(getAdvertisedDodagId());
     dio->setSrcAddress(getSelfAddress());
-    dio->setPosition(position);
-    dio->setNodeName(hostName.c_str());
-    dio->setIsMobile(isMobile);
     dio->setSlotOffset(uplinkSlotOffset);
-    if (isRoot)
-        dio->setColor(dodagColor);
-    else
-        dio->setColor(preferredParent ? preferredParent->getColor() : cFigure::GREY);
+    if (guiInfoEnabled) {
+        auto guiTag = dio->addTag<RplGuiTag>();
+        guiTag->setNodeName(hostName.c_str());
+        guiTag->setIsMobile(isMobile);
+        guiTag->setPosition(position);
+        guiTag->setColor(getAdvertisedColor());
+    }
 
     EV_DETAIL << "DIO created advertising DODAG - " << dio->getDodagId()
                 << " and rank " << dio->getRank() << endl;
@@ -804,17 +1228,106 @@ const Ptr<Dio> Rpl::createDio()
     return dio;
 }
 
+uint8_t Rpl::getAdvertisedMop()
+{
+    if (!instance->storing)
+        return MOP_NON_STORING;
+    return instance->multicast ? MOP_STORING_MULTICAST : MOP_STORING_NO_MULTICAST;
+}
+
+Ipv6Address Rpl::getAdvertisedDodagId()
+{
+    if (isRoot)
+        return virtualDodagId.isUnspecified() ? getSelfAddress() : virtualDodagId;
+    return instance->dodagId;
+}
+
+cFigure::Color Rpl::getAdvertisedColor()
+{
+    if (isRoot)
+        return dodagColor;
+    return instance->preferredParent ? getNeighborColor(instance->preferredParent) : cFigure::GREY;
+}
+
+cFigure::Color Rpl::getNeighborColor(const Dio *dio) const
+{
+    auto guiTag = dio->findTag<RplGuiTag>();
+    return guiTag ? guiTag->getColor() : cFigure::GREY;
+}
+
+bool Rpl::isDioUpToDate(const Dio *dio)
+{
+    if (guiInfoEnabled) {
+        auto color = getAdvertisedColor();
+        auto advertisedColor = dio->getTag<RplGuiTag>()->getColor();
+        if (advertisedColor.red != color.red || advertisedColor.green != color.green || advertisedColor.blue != color.blue)
+            return false;
+    }
+    return dio->getRank() == instance->rank && dio->getDodagVersion() == instance->dodagVersion
+            && dio->getDtsn() == instance->dtsn && dio->getStoring() == instance->storing && dio->getMop() == getAdvertisedMop()
+            && dio->getDodagId() == getAdvertisedDodagId() && dio->getSlotOffset() == uplinkSlotOffset;
+}
+
+const Ptr<const Dio>& Rpl::getDio(InterfaceEntry *ie)
+{
+    auto& dio = instance->dioCache[ie->getInterfaceId()];
+    if (!dio || !isDioUpToDate(dio.get())) {
+        auto freshDio = createDio();
+        // neighbors address this node by the interface they hear it on
+        freshDio->setSrcAddress(ie->getNetworkAddress().toIpv6());
+        freshDio->setNodeId(ie->getMacAddress().getInt());
+        dio = freshDio;
+    }
+    return dio;
+}
+
+void Rpl::multicastDio(double delay)
+{
+    for (auto ie : rplInterfaces)
+        sendRplPacket(getDio(ie), DIO, Ipv6Address::ALL_NODES_1, delay, ie->getInterfaceName());
+}
+
+
+const Ptr<Dis> Rpl::createDis()
+{
+    auto dis = makeShared<Dis>();
+    dis->setInstanceId(instance->instanceId);
+    dis->setChunkLength(getDisSize());
+    dis->setSrcAddress(getSelfAddress());
+    dis->setNodeId(selfId);
+    return dis;
+}
+
+void Rpl::processDis(const Ptr<const Dis>& dis, const L3Address &destAddr)
+{
+    // Only nodes already participating in a DODAG have DIOs to offer
+    if (!isRoot && (!instance->preferredParent || instance->rank == INF_RANK)) {
+        EV_DETAIL << "Not joined to a DODAG, ignoring DIS from " << dis->getSrcAddress() << endl;
+        return;
+    }
+
+    if (destAddr.isMulticast()) {
+        EV_DETAIL << "Multicast DIS received from " << dis->getSrcAddress() << ", resetting trickle timer" << endl;
+        instance->trickleTimer->reset(TRICKLE_RESET_DIS_RECEIVED);
+    }
+    else {
+        EV_DETAIL << "Unicast DIS received from " << dis->getSrcAddress() << ", answering with DIO" << endl;
+        sendRplPacket(getDio(getInterfaceTowards(dis->getSrcAddress())), DIO, dis->getSrcAddress(), 0);
+    }
+}
 
 const Ptr<Dao> Rpl::createDao(const Ipv6Address &reachableDest)
 {
     auto dao = makeShared<Dao>();
-    dao->setInstanceId(instanceId);
-    dao->setChunkLength(b(64));
+    dao->setInstanceId(instance->instanceId);
     dao->setSrcAddress(getSelfAddress());
     dao->setReachableDest(reachableDest);
+    dao->setChunkLength(getDaoLength(dao.get()));
     dao->setSeqNum(daoSeqNum++);
+    dao->setPathSequence(instance->pathSequence);
     dao->setNodeId(selfId);
-    dao->setDaoAckRequired(pDaoAckEnabled);
+    // pending DAO-ACKs are tracked for the primary instance only
+    dao->setDaoAckRequired(pDaoAckEnabled && instance->isPrimary());
 
     // Flags only used by TSCH
     dao->setDownlinkRequired(par("downlinkRequired").boolValue());
@@ -824,6 +1337,60 @@ const Ptr<Dao> Rpl::createDao(const Ipv6Address &reachableDest)
     return dao;
 }
 
+std::vector<Ipv6Address> Rpl::getDaoTargets(const Dao *dao)
+{
+    std::vector<Ipv6Address> targets = { dao->getReachableDest() };
+    for (size_t i = 0; i < dao->getKnownTargetsArraySize(); i++)
+        targets.push_back(dao->getKnownTargets(i));
+    return targets;
+}
+
+void Rpl::setDaoTargets(const Ptr<Dao>& dao, const std::vector<Ipv6Address> &targets)
+{
+    ASSERT(!targets.empty());
+    dao->setReachableDest(targets.front());
+    dao->setKnownTargetsArraySize(targets.size() - 1);
+    for (size_t i = 1; i < targets.size(); i++)
+        dao->setKnownTargets(i - 1, targets[i]);
+    dao->setChunkLength(getDaoLength(dao.get()));
+}
+
+B Rpl::getDaoLength(const Dao *dao)
+{
+    auto dodagIdLength = dao->getDodagId().isUnspecified() ? 0 : RPL_DODAG_ID_LENGTH;
+    // targets of DAO-ACK are not transmitted, acknowledgement refers to the DAO sequence number
+    if (dynamic_cast<const DaoAck *>(dao))
+        return B(RPL_DAO_ACK_BASE_LENGTH + dodagIdLength);
+    // Target and Transit (with parent address) options are accounted by the appended chunks
+    if (dao->getTransitOptionsAppended())
+        return B(RPL_DAO_BASE_LENGTH + dodagIdLength);
+    return B(RPL_DAO_BASE_LENGTH + dodagIdLength + RPL_TARGET_OPTION_LENGTH * getDaoTargets(dao).size()
+            + RPL_TRANSIT_OPTION_LENGTH);
+}
+
+std::vector<Ptr<Dao>> Rpl::createDaos(const std::vector<Ipv6Address> &targets)
+{
+    // single Transit option per DAO carries one path sequence for all of its targets
+    std::map<uint8_t, std::vector<Ipv6Address>> targetsByPathSequence;
+    for (auto target : targets)
+        targetsByPathSequence[getPathSequence(target)].push_back(target);
+
+    std::vector<Ptr<Dao>> daos;
+    for (auto const &group : targetsByPathSequence) {
+        auto &seqTargets = group.second;
+        for (size_t i = 0; i < seqTargets.size(); i += maxDaoTargets) {
+            auto last = std::min(seqTargets.size(), i + maxDaoTargets);
+            std::vector<Ipv6Address> daoTargets(seqTargets.begin() + i, seqTargets.begin() + last);
+
+            auto dao = createDao(daoTargets.front());
+            setDaoTargets(dao, daoTargets);
+            dao->setPathSequence(group.first);
+            daos.push_back(dao);
+        }
+    }
+    return daos;
+}
+
 const Ptr<Dao> Rpl::createDao(const Ipv6Address &reachableDest, bool ackRequired)
 {
     auto dao = createDao(reachableDest);
@@ -831,6 +1398,19 @@ const Ptr<Dao> Rpl::createDao(const Ipv6Address &reachableDest, bool ackRequired
     return dao;
 }
 
+const Ptr<DaoAck> Rpl::createDaoAck(const Ptr<const Dao>& dao)
+{
+    auto daoAck = makeShared<DaoAck>();
+    daoAck->setInstanceId(instance->instanceId);
+    daoAck->setSrcAddress(getSelfAddress());
+    daoAck->setSeqNum(dao->getSeqNum());
+    daoAck->setNodeId(selfId);
+    daoAck->setChunkLength(getDaoLength(daoAck.get()));
+    if (daoCongestionHintEnabled)
+        daoAck->setCongestionHint(getDaoCongestionLevel());
+    return daoAck;
+}
+
 bool Rpl::isUdpSink(cModule* app) {
     if (!app)
         return false;
@@ -845,8 +1425,8 @@ bool Rpl::isInvalidDio(const Dio* dio) {
     // 1st clause: if the node is detached from the DODAG and the advertised rank is INFINITE_RANK, discard the packet
     // 2nd clause: if the node has preferred parent but the DIO advertising INFINITE_RANK is NOT coming from the preferred parent,
     // discard the packet
-    return (!preferredParent && dio->getRank() == INF_RANK)
-            || (preferredParent && preferredParent->getSrcAddress() != dio->getSrcAddress() && dio->getRank() == INF_RANK);
+    return (!instance->preferredParent && dio->getRank() == INF_RANK)
+            || (instance->preferredParent && instance->preferredParent->getSrcAddress() != dio->getSrcAddress() && dio->getRank() == INF_RANK);
 }
 
 void Rpl::processDio(const Ptr<const Dio>& dio)
@@ -858,14 +1438,21 @@ void Rpl::processDio(const Ptr<const Dio>& dio)
     EV_DETAIL << "Processing DIO from " << dioSenderAddr
                 << " (MAC - " << MacAddress(dio->getNodeId()) << "), advertised rank - " << dio->getRank() << endl;
 
-    if (!nd->neighbourCache.lookup(dioSenderAddr, interfaceEntryPtr->getInterfaceId()))
+    auto dioInterfaceId = getInterfaceTowards(dioSenderAddr)->getInterfaceId();
+    if (!nd->neighbourCache.lookup(dioSenderAddr, dioInterfaceId))
     {
-        auto nce = nd->neighbourCache.addNeighbour(dioSenderAddr, interfaceEntryPtr->getInterfaceId(), MacAddress(dio->getNodeId()));
+        auto nce = nd->neighbourCache.addNeighbour(dioSenderAddr, dioInterfaceId, MacAddress(dio->getNodeId()));
         nce->reachabilityState = Ipv6NeighbourCache::REACHABLE;
         nce->reachabilityExpires = SIMTIME_MAX;
     }
 
-    emit(dioReceivedSignal, dio->dup());
+    emit(dioReceivedSignal, 1L);
+    // failed parent is back, frames dropped towards it from now on are not due to its failure
+    if (!failedParentMac.isUnspecified() && MacAddress(dio->getNodeId()) == failedParentMac)
+        failedParentMac = MacAddress::UNSPECIFIED_ADDRESS;
+    // listeners get the received chunk itself, they must not keep or modify it
+    if (emitReceivedPackets && mayHaveListeners(dioReceivedPacketSignal))
+        emit(dioReceivedPacketSignal, const_cast<Dio *>(dio.get()));
 
     // Custom low-latency mode part:
     // do not join a DODAG if no slot offset is advertised (required for cell daisy-chain)
@@ -873,21 +1460,23 @@ void Rpl::processDio(const Ptr<const Dio>& dio)
         return;
 
     // If node's not a part of any DODAG, join the first one advertised
-    if (dodagId == Ipv6Address::UNSPECIFIED_ADDRESS)
+    if (instance->dodagId == Ipv6Address::UNSPECIFIED_ADDRESS)
     {
-        dodagId = dio->getDodagId();
-        dodagVersion = dio->getDodagVersion();
-        instanceId = dio->getInstanceId();
-        storing = dio->getStoring();
-        dtsn = dio->getDtsn();
-        lastTarget = new Ipv6Address(getSelfAddress());
-        dodagColor = dio->getColor();
-        EV_DETAIL << "Joined DODAG with id - " << dodagId << endl;
+        instance->dodagId = dio->getDodagId();
+        instance->dodagVersion = dio->getDodagVersion();
+        instance->instanceId = dio->getInstanceId();
+        instance->storing = dio->getStoring();
+        instance->multicast = dio->getMop() == MOP_STORING_MULTICAST;
+        instance->dtsn = dio->getDtsn();
+        lastTarget = getSelfAddress();
+        if (guiInfoEnabled)
+            dodagColor = getNeighborColor(dio.get());
+        EV_DETAIL << "Joined DODAG with id - " << instance->dodagId << endl;
         // Start broadcasting DIOs, diffusing DODAG control data, TODO: refactor TT lifecycle
-        if (trickleTimer->hasStarted())
-            trickleTimer->reset();
+        if (instance->trickleTimer->hasStarted())
+            instance->trickleTimer->reset(TRICKLE_RESET_DODAG_JOINED);
         else
-            trickleTimer->start(false, par("numSkipTrickleIntervalUpdates").intValue());
+            instance->trickleTimer->start(false, par("numSkipTrickleIntervalUpdates").intValue());
 
         // Avoid overwriting manually set dest address
         for (auto app : apps)
@@ -895,7 +1484,7 @@ void Rpl::processDio(const Ptr<const Dio>& dio)
                 app->par("destAddresses") = dio->getDodagId().str();
     }
     else {
-        if (!allowDodagSwitching && dio->getDodagId() != dodagId) {
+        if (!allowDodagSwitching && dio->getDodagId() != instance->dodagId) {
             EV_DETAIL << "Node already joined a DODAG, skipping DIO advertising other ones" << endl;
             return;
         }
@@ -905,20 +1494,38 @@ void Rpl::processDio(const Ptr<const Dio>& dio)
          */
         if (checkPoisonedParent(dio)) {
             EV_DETAIL << "Received poisoned DIO from preferred parent - "
-                    << preferredParent->getSrcAddress() << endl;
+                    << instance->preferredParent->getSrcAddress() << endl;
             deletePrefParent(true);
             updatePrefParent();
             return;
         }
+
+        if (dio->getDodagId() == instance->dodagId && dio->getDodagVersion() != instance->dodagVersion) {
+            // DIOs of an older version must not be used for parent selection [RFC 6550, 8.2.2.2]
+            if (!lollipopGreater(dio->getDodagVersion(), instance->dodagVersion)) {
+                EV_DETAIL << "DIO advertises outdated DODAG version " << (int) dio->getDodagVersion()
+                        << ", discarding" << endl;
+                return;
+            }
+            joinNewDodagVersion(dio);
+        }
+    }
+    instance->trickleTimer->ctrlMsgReceived();
+
+    // Newer DTSN from the preferred parent requests re-advertising downward routes [RFC 6550, 9.6]
+    if (instance->preferredParent && dioSenderAddr == instance->preferredParent->getSrcAddress()
+            && lollipopGreater(dio->getDtsn(), instance->preferredParent->getDtsn()))
+    {
+        EV_DETAIL << "Pref. parent incremented DTSN to " << (int) dio->getDtsn() << ", refreshing DAO" << endl;
+        scheduleDaoRefresh();
     }
-    trickleTimer->ctrlMsgReceived();
 
 //    // Do not process DIO from unknown DAG/RPL instance, TODO: check with RFC
 //    if (checkUnknownDio(dio)) {
 //        EV_DETAIL << "Unknown DODAG/InstanceId, or receiver is root - discarding DIO" << endl;
 //        return;
 //    }
-    if (dio->getRank() > rank) {
+    if (dio->getRank() > instance->rank) {
         EV_DETAIL << "Higher rank advertised, discarding DIO" << endl;
         return;
     }
@@ -934,7 +1541,7 @@ void Rpl::purgeRoutingTable() {
 }
 
 bool Rpl::checkPoisonedParent(const Ptr<const Dio>& dio) {
-    return preferredParent && dio->getRank() == INF_RANK && preferredParent->getSrcAddress() == dio->getSrcAddress();
+    return instance->preferredParent && dio->getRank() == INF_RANK && instance->preferredParent->getSrcAddress() == dio->getSrcAddress();
 }
 
 void Rpl::processDao(const Ptr<const Dao>& dao) {
@@ -945,36 +1552,63 @@ void Rpl::processDao(const Ptr<const Dao>& dao) {
 
     auto daoSender = dao->getSrcAddress();
 
-    if (!nd->neighbourCache.lookup(daoSender, interfaceEntryPtr->getInterfaceId()))
+    auto daoInterfaceId = getInterfaceTowards(daoSender)->getInterfaceId();
+    if (!nd->neighbourCache.lookup(daoSender, daoInterfaceId))
     {
-        auto nce = nd->neighbourCache.addNeighbour(daoSender, interfaceEntryPtr->getInterfaceId(), MacAddress(dao->getNodeId()));
+        auto nce = nd->neighbourCache.addNeighbour(daoSender, daoInterfaceId, MacAddress(dao->getNodeId()));
         nce->reachabilityState = Ipv6NeighbourCache::REACHABLE;
         nce->reachabilityExpires = SIMTIME_MAX;
     }
 
-    if (!isRoot && !preferredParent) {
+    if (!isRoot && !instance->preferredParent) {
         EV_DETAIL << "Node is detached from DODAG, discarding DAO" << endl;
         return;
     }
 
-    emit(daoReceivedSignal, dao->dup());
+    emit(daoReceivedSignal, 1L);
+    if (emitReceivedPackets && mayHaveListeners(daoReceivedPacketSignal))
+        emit(daoReceivedPacketSignal, const_cast<Dao *>(dao.get()));
 
-    if (!isRoot && daoSender == preferredParent->getSrcAddress())
+    if (!isRoot && daoSender == instance->preferredParent->getSrcAddress())
         throw cRuntimeError("Received DAO from preferred parent, loop detected!");
 
     auto advertisedDest = dao->getReachableDest();
+    auto targets = getDaoTargets(dao.get());
     EV_DETAIL << "Processing DAO with seq num " << std::to_string(dao->getSeqNum()) << " from "
-            << daoSender << " advertising " << advertisedDest << endl;
+            << daoSender << " advertising " << advertisedDest
+            << (targets.size() > 1 ? " and " + std::to_string(targets.size() - 1) + " more targets" : "") << endl;
+
+    if (isRoot && daoCongestionHintEnabled)
+        updateDaoCongestionLevel();
 
-    if (dao->getDaoAckRequired())
-        sendRplPacket(createDao(advertisedDest), DAO_ACK, daoSender, uniform(1, 3)); // TODO: magic numbers
+    if (dao->getDaoAckRequired()) {
+        sendRplPacket(createDaoAck(dao), DAO_ACK, daoSender, uniform(1, 3)); // TODO: magic numbers
+    }
+
+    if (dao->getPathLifetime() == NO_PATH_LIFETIME) {
+        if (instance->storing || isRoot)
+            processNoPathDao(dao);
+        return;
+    }
+
+    // delayed DAO mustn't take over the path a newer one has already set up
+    targets.erase(std::remove_if(targets.begin(), targets.end(), [&](const Ipv6Address &target) {
+        return isStalePathSequence(target, dao->getPathSequence());
+    }), targets.end());
+    if (targets.empty()) {
+        EV_DETAIL << "DAO path sequence " << (int) dao->getPathSequence() << " is outdated, discarding" << endl;
+        return;
+    }
+    advertisedDest = targets.front();
+
+    if (isVirtualRoot() && instance->isPrimary() && instance->storing)
+        shareDaoRoutes(targets, dao->getPathLifetime());
 
     /**
      * If a node is root or operates in storing mode
      * update routing table with destinations from DAO [RFC6560, 3.3].
-     * TODO: Implement DAO aggregation!
      */
-    if (storing || isRoot) {
+    if (instance->storing || isRoot) {
 //        if (!checkDestKnown(daoSender, advertisedDest)) {
 //            updateRoutingTable(daoSender, advertisedDest, prepRouteData(dao.get()));
 //            emit(childJoinedSignal, 1);
@@ -984,7 +1618,8 @@ void Rpl::processDao(const Ptr<const Dao>& dao) {
 //        }
 //        else
 //            return;
-        bool isNewRoute = updateRoutingTable(daoSender, advertisedDest, prepRouteData(dao.get()));
+        for (auto target : targets)
+            updateRoutingTable(daoSender, target, prepRouteData(dao.get()));
 
         // Only in combination with TSCH:
         // Check if extra up-/downlink bandwidth is required (TODO: only if a new route is learned)
@@ -1004,129 +1639,302 @@ void Rpl::processDao(const Ptr<const Dao>& dao) {
     /**
      * Forward DAO 'upwards' via preferred parent advertising destination to the root [RFC6560, 6.4]
      */
-    if (!isRoot && preferredParent) {
+    if (!isRoot && instance->preferredParent) {
+        // Target/Transit pairs of non-storing mode can't be merged, hence aggregate in storing mode only,
+        // aggregation timer is node-wide and thus serves the primary instance
+        if (instance->storing && daoCoalescingWindow > 0 && instance->isPrimary()) {
+            coalesceDaoTargets(targets, dao->getDownlinkRequired(), dao->getUplinkRequired());
+            return;
+        }
+
         auto fwdDao = createDao(advertisedDest);
+        setDaoTargets(fwdDao, targets);
+        fwdDao->setPathSequence(dao->getPathSequence());
         fwdDao->setDownlinkRequired(dao->getDownlinkRequired());
         fwdDao->setUplinkRequired(dao->getUplinkRequired());
 
-        if (!storing)
-            sendRplPacket(fwdDao, DAO, preferredParent->getSrcAddress(), daoDelay * uniform(1, 2), *lastTarget, *lastTransit);
+        if (!instance->storing)
+            sendRplPacket(fwdDao, DAO, instance->preferredParent->getSrcAddress(), daoDelay * uniform(1, 2), lastTarget, lastTransit);
         else
-            sendRplPacket(fwdDao, DAO, preferredParent->getSrcAddress(), daoDelay * uniform(1, 2));
+            sendRplPacket(fwdDao, DAO, instance->preferredParent->getSrcAddress(), daoDelay * uniform(1, 2));
 
         numDaoForwarded++;
-        EV_DETAIL << "Forwarding DAO to " << preferredParent->getSrcAddress()
+        EV_DETAIL << "Forwarding DAO to " << instance->preferredParent->getSrcAddress()
                 << " advertising " << advertisedDest << " reachability" << endl;
     }
 }
 
-std::vector<Ipv6Address> Rpl::getNearestChildren() {
-    auto prefParentAddr = preferredParent ? preferredParent->getSrcAddress() : Ipv6Address::UNSPECIFIED_ADDRESS;
-    std::vector<Ipv6Address> neighbrs = {};
-    for (auto i = 0; i < routingTable->getNumRoutes(); i++) {
-        auto rt = routingTable->getRoute(i);
-        auto dest = rt->getDestPrefix();
-        auto nextHop = rt->getNextHop();
+void Rpl::coalesceDaoTargets(const std::vector<Ipv6Address> &targets, bool downlinkRequired, bool uplinkRequired)
+{
+    for (auto target : targets)
+        if (std::find(coalescedDaoTargets.begin(), coalescedDaoTargets.end(), target) == coalescedDaoTargets.end())
+            coalescedDaoTargets.push_back(target);
 
-        if (dest == nextHop && dest != prefParentAddr)
-            neighbrs.push_back(nextHop);
+    coalescedDownlinkRequired |= downlinkRequired;
+    coalescedUplinkRequired |= uplinkRequired;
+
+    EV_DETAIL << "Coalescing DAO targets, " << coalescedDaoTargets.size() << " pending" << endl;
+
+    if ((int) coalescedDaoTargets.size() >= maxDaoTargets) {
+        EV_DETAIL << "DAO frame size limit reached, forwarding coalesced targets right away" << endl;
+        flushCoalescedDaoTargets();
+        return;
     }
 
-    EV_DETAIL << "Found 1-hop neighbors (" << neighbrs.size() << ") - " << neighbrs << endl;
-    return neighbrs;
+    if (!daoCoalescingEvent->isScheduled())
+        scheduleAt(simTime() + daoCoalescingWindow, daoCoalescingEvent);
 }
 
-void Rpl::processDaoAck(const Ptr<const Dao>& daoAck) {
-    auto advDest = daoAck->getReachableDest();
+void Rpl::flushCoalescedDaoTargets()
+{
+    cancelEvent(daoCoalescingEvent);
 
-    EV_INFO << "Received DAO_ACK from " << daoAck->getSrcAddress()
-            << " for advertised dest - "  << advDest << endl;
+    if (!instance->preferredParent) {
+        EV_WARN << "Preferred parent not set, dropping " << coalescedDaoTargets.size()
+                << " coalesced DAO targets" << endl;
+        coalescedDaoTargets.clear();
+        return;
+    }
 
-    if (pendingDaoAcks.empty()) {
-        EV_DETAIL << "No DAO_ACKs were expected!" << endl;
+    for (auto fwdDao : createDaos(coalescedDaoTargets)) {
+        fwdDao->setDownlinkRequired(coalescedDownlinkRequired);
+        fwdDao->setUplinkRequired(coalescedUplinkRequired);
+        sendRplPacket(fwdDao, DAO, instance->preferredParent->getSrcAddress(), uniform(0, daoDelay));
+
+        numDaoForwarded++;
+        EV_DETAIL << "Forwarding aggregated DAO to " << instance->preferredParent->getSrcAddress()
+                << " advertising " << fwdDao->getKnownTargetsArraySize() + 1 << " targets" << endl;
+    }
+
+    coalescedDaoTargets.clear();
+    coalescedDownlinkRequired = false;
+    coalescedUplinkRequired = false;
+}
+
+void Rpl::processNoPathDao(const Ptr<const Dao>& dao)
+{
+    auto daoSender = dao->getSrcAddress();
+    std::vector<Ipv6Address> removedTargets;
+
+    /**
+     * Only remove routes that still point to the No-Path sender. If the target has
+     * already been re-advertised via another child (new branch), the stale part
+     * of the DODAG ends here and No-Path is not propagated further. The same holds
+     * for routes learned from a newer path than the one being withdrawn
+     */
+    for (auto target : getDaoTargets(dao.get()))
+        if (!isStalePathSequence(target, dao->getPathSequence()) && deleteDaoRoute(target, daoSender))
+            removedTargets.push_back(target);
+
+    EV_DETAIL << "No-Path DAO from " << daoSender << " removed " << removedTargets.size() << " downward routes" << endl;
+
+    if (!removedTargets.empty() && isVirtualRoot() && instance->isPrimary() && instance->storing)
+        shareDaoRoutes(removedTargets, NO_PATH_LIFETIME);
+
+    if (removedTargets.empty() || isRoot || !instance->preferredParent || !instance->storing)
         return;
+
+    for (auto noPathDao : createDaos(removedTargets)) {
+        noPathDao->setPathLifetime(NO_PATH_LIFETIME);
+        noPathDao->setPathSequence(dao->getPathSequence());
+        noPathDao->setDaoAckRequired(false);
+        sendRplPacket(noPathDao, DAO, instance->preferredParent->getSrcAddress(), uniform(0, daoDelay));
+        numDaoForwarded++;
+    }
+}
+
+void Rpl::sendNoPathDao(const Ipv6Address &oldParentAddr, const std::vector<Ipv6Address> &targets, double delay)
+{
+    /**
+     * DAO-ACK is not requested, since pending ACKs are tracked per target and
+     * the same targets are being advertised to the new preferred parent
+     */
+    for (auto noPathDao : createDaos(targets)) {
+        noPathDao->setPathLifetime(NO_PATH_LIFETIME);
+        noPathDao->setDaoAckRequired(false);
+        sendRplPacket(noPathDao, DAO, oldParentAddr, delay);
     }
 
-    clearDaoAckTimer(advDest);
+    EV_DETAIL << "Sending No-Path DAO to former pref. parent - " << oldParentAddr
+            << " for " << targets.size() << " targets" << endl;
+}
 
-    EV_DETAIL << "Cancelled timeout event and erased entry in the pendingDaoAcks, remaining: " << endl;
+std::vector<Ipv6Address> Rpl::getDownwardTargets()
+{
+    std::vector<Ipv6Address> targets;
+    if (!instance->isPrimary()) {
+        for (auto const &route : instance->downwardRoutes)
+            if (route.first != route.second)
+                targets.push_back(route.first);
+        return targets;
+    }
 
-    for (auto e : pendingDaoAcks)
-        EV_DETAIL << e.first << " retries: " << std::to_string(e.second->numRetries)
-            << ", msg ptr - " << e.second->timeoutPtr << endl;
+    for (int i = 0; i < routingTable->getNumRoutes(); i++) {
+        auto ri = routingTable->getRoute(i);
+        if (dynamic_cast<RplRouteData *> (ri->getProtocolData()) && ri->getPrefixLength() == prefixLength)
+            targets.push_back(ri->getDestPrefix());
+    }
+    return targets;
 }
 
+uint8_t Rpl::getPathSequence(const Ipv6Address &dest)
+{
+    auto ownTargets = getOwnTargets();
+    if (std::find(ownTargets.begin(), ownTargets.end(), dest) != ownTargets.end())
+        return instance->pathSequence;
+
+    uint8_t pathSequence;
+    return findStoredPathSequence(dest, pathSequence) ? pathSequence : instance->pathSequence;
+}
 
-void Rpl::setParentConnectorProps(cLineFigure *connector, Coord target, cFigure::Color col, bool dashed) const
+bool Rpl::isStalePathSequence(const Ipv6Address &dest, uint8_t pathSequence)
 {
-    connector->setStart(cFigure::Point(position.x, position.y));
-    connector->setEnd(cFigure::Point(target.x, target.y));
-    connector->setLineWidth(2);
-    connector->setLineColor(col);
-    connector->setLineOpacity(dashed ? 0.5 : 1);
-    if (dashed)
-        connector->setLineStyle(cFigure::LineStyle::LINE_DASHED);
-    connector->setEndArrowhead(cFigure::ARROW_BARBED);
-    connector->setVisible(true);
+    uint8_t storedPathSequence;
+    return findStoredPathSequence(dest, storedPathSequence) && lollipopGreater(storedPathSequence, pathSequence);
 }
 
+bool Rpl::findStoredPathSequence(const Ipv6Address &dest, uint8_t &pathSequence)
+{
+    if (!instance->isPrimary()) {
+        auto stored = instance->downwardPathSequences.find(dest);
+        if (stored == instance->downwardPathSequences.end())
+            return false;
+        pathSequence = stored->second;
+        return true;
+    }
 
-void Rpl::drawConnector(Coord target, cFigure::Color col, Ipv6Address backupParent) const {
-    // (0, 0) corresponds to default Coord constructor, meaning no target position was provided
-    if ((!target.x && !target.y) || !par("drawConnectors").boolValue())
-        return;
+    for (int i = 0; i < routingTable->getNumRoutes(); i++) {
+        auto ri = routingTable->getRoute(i);
+        auto routeData = dynamic_cast<RplRouteData *> (ri->getProtocolData());
+        if (routeData && ri->getDestPrefix() == dest) {
+            pathSequence = routeData->getPathSequence();
+            return true;
+        }
+    }
+    return false;
+}
 
-    cCanvas *canvas = getParentModule()->getParentModule()->getCanvas();
+bool Rpl::deleteDaoRoute(const Ipv6Address &dest, const Ipv6Address &nextHop)
+{
+    if (!instance->isPrimary()) {
+        auto route = instance->downwardRoutes.find(dest);
+        if (route == instance->downwardRoutes.end() || route->second != nextHop)
+            return false;
+        instance->downwardRoutes.erase(route);
+        instance->downwardPathSequences.erase(dest);
+        return true;
+    }
 
-    // If a valid pointer to backup parent address is provided
-    // And there's no line drawn to it, create a new one
-    if (backupParent != Ipv6Address::UNSPECIFIED_ADDRESS) {
-        if (backupConnectors.find(backupParent) == backupConnectors.end()) {
-            backupConnectors[backupParent] = new cLineFigure("backupParentConnector");
-            setParentConnectorProps(backupConnectors[backupParent], target, col, true);
-            canvas->addFigure(backupConnectors[backupParent]);
+    for (int i = 0; i < routingTable->getNumRoutes(); i++) {
+        auto ri = routingTable->getRoute(i);
+        if (ri->getDestPrefix() == dest && ri->getNextHop() == nextHop && ri->getPrefixLength() > 0) {
+            routingTable->deleteRoute(ri);
+            routingTable->purgeDestCache();
+            return true;
         }
-        return;
     }
+    return false;
+}
 
-    // If an arrow to preferred parent is already present, we only need to update its properties
-    if (prefParentConnector) {
-        prefParentConnector->setLineColor(col);
-        prefParentConnector->setEnd(cFigure::Point(target.x, target.y));
-        return;
+void Rpl::initializeVirtualRoot()
+{
+    backboneInterface = interfaceTable->findInterfaceByName(par("backboneInterface").stringValue());
+    if (!backboneInterface)
+        throw cRuntimeError("Virtual DODAG root requires backbone interface '%s'", par("backboneInterface").stringValue());
+
+    // loopback keeps the address off the radio interface, preserving getSelfAddress()
+    interfaceTable->findFirstLoopbackInterface()->getProtocolData<Ipv6InterfaceData>()->assignAddress(virtualDodagId,
+            false, SIMTIME_ZERO, SIMTIME_ZERO);
+
+    instance = instances.front();
+    shareDaoRoutes({getSelfAddress()}, INFINITE_PATH_LIFETIME);
+    EV_DETAIL << "Acting as a root of virtual DODAG " << virtualDodagId << " over " << backboneInterface->getInterfaceName() << endl;
+}
+
+void Rpl::shareDaoRoutes(const std::vector<Ipv6Address> &targets, uint8_t pathLifetime)
+{
+    for (auto dao : createDaos(targets)) {
+        dao->setPathLifetime(pathLifetime);
+        dao->setDaoAckRequired(false);
+        sendRplPacket(dao, DAO, Ipv6Address::ALL_NODES_1, 0, backboneInterface->getInterfaceName());
     }
+    EV_DETAIL << (pathLifetime == NO_PATH_LIFETIME ? "Withdrawing " : "Sharing ") << targets.size()
+            << " downward routes with other roots over the backbone" << endl;
+}
 
-    // Otherwise create a new line and add it to canvas
-    prefParentConnector = new cLineFigure("preferredParentConnector");
-    setParentConnectorProps(prefParentConnector, target, col);
-    canvas->addFigure(prefParentConnector);
+void Rpl::processBackboneDao(const Ptr<const Dao>& dao, const Ipv6Address &peerAddr)
+{
+    auto targets = getDaoTargets(dao.get());
+    EV_DETAIL << "Root " << peerAddr << " shared " << targets.size() << " downward routes over the backbone" << endl;
+
+    for (auto target : targets) {
+        if (dao->getPathLifetime() == NO_PATH_LIFETIME)
+            deleteDaoRoute(target, peerAddr);
+        else if (target != getSelfAddress())
+            updateRoutingTable(peerAddr, target, prepRouteData(dao.get()), false, backboneInterface);
+    }
 }
 
-void Rpl::setParentMobility(Dio* prefParent) {
-    if (!prefParent || !prefParent->isMobile())
+std::vector<Ipv6Address> Rpl::getNearestChildren() {
+    auto prefParentAddr = instance->preferredParent ? instance->preferredParent->getSrcAddress() : Ipv6Address::UNSPECIFIED_ADDRESS;
+    std::vector<Ipv6Address> neighbrs = {};
+    for (auto i = 0; i < routingTable->getNumRoutes(); i++) {
+        auto rt = routingTable->getRoute(i);
+        auto dest = rt->getDestPrefix();
+        auto nextHop = rt->getNextHop();
+
+        if (dest == nextHop && dest != prefParentAddr)
+            neighbrs.push_back(nextHop);
+    }
+
+    EV_DETAIL << "Found 1-hop neighbors (" << neighbrs.size() << ") - " << neighbrs << endl;
+    return neighbrs;
+}
+
+void Rpl::processDaoAck(const Ptr<const Dao>& daoAck) {
+    EV_INFO << "Received DAO_ACK from " << daoAck->getSrcAddress()
+            << " for DAO with seq num " << std::to_string(daoAck->getSeqNum()) << endl;
+
+    if (pendingDaoAcks.empty()) {
+        EV_DETAIL << "No DAO_ACKs were expected!" << endl;
         return;
+    }
+
+    auto ackedTargets = daoAckTargets.find(daoAck->getSeqNum());
+    if (ackedTargets != daoAckTargets.end()) {
+        for (auto target : ackedTargets->second)
+            clearDaoAckTimer(target);
+        daoAckTargets.erase(ackedTargets);
+    }
+    else
+        EV_DETAIL << "No DAO with seq num " << std::to_string(daoAck->getSeqNum()) << " awaits acknowledgement" << endl;
 
-    auto prefParentModule = findSubmodule(prefParent->getNodeName(), host->getParentModule());
+    // ACKs from the preferred parent relay the congestion level of the root
+    if (daoCongestionHintEnabled && instance->preferredParent && daoAck->getSrcAddress() == instance->preferredParent->getSrcAddress()) {
+        daoCongestionLevel = std::min((int) daoAck->getCongestionHint(), MAX_DAO_CONGESTION_LEVEL);
+        daoCongestionLevelUpdatedAt = simTime();
+        EV_DETAIL << "DODAG congestion level updated to " << (int) daoCongestionLevel << endl;
+    }
 
-    if (prefParentModule)
-        parentMobilityMod = check_and_cast<IMobility*> (prefParentModule->getSubmodule("mobility"));
+    EV_DETAIL << "Erased entry in the pendingDaoAcks, remaining: " << pendingDaoAcks.str() << endl;
 }
 
+
 void Rpl::updatePrefParent()
 {
     Dio *newPrefParent;
     EV_DETAIL << "Choosing preferred parent from "
-            << boolStr(candidateParents.empty() && par("useBackupAsPreferred").boolValue(),
+            << boolStr(instance->candidateParents.empty() && par("useBackupAsPreferred").boolValue(),
                     "backup", "candidate") << " parent set:" << endl;
     /**
      * Choose parent from candidate neighbour set. If it's empty, leave the DODAG.
      */
-    if (candidateParents.empty())
+    if (instance->candidateParents.empty())
     {
         EV_DETAIL << "Candidate parent list empty" << endl;
         if (par("useBackupAsPreferred").boolValue()) {
             EV_DETAIL << "Selecting preferred parent from backup parents:" << endl;
-            newPrefParent = objectiveFunction->getPreferredParent(backupParents, preferredParent);
+            newPrefParent = instance->objectiveFunction->getPreferredParent(instance->backupParents, instance->preferredParent);
         }
         else {
             EV_DETAIL << "Leaving DODAG" << endl;
@@ -1135,7 +1943,7 @@ void Rpl::updatePrefParent()
         }
     }
     else
-        newPrefParent = objectiveFunction->getPreferredParent(candidateParents, preferredParent);
+        newPrefParent = instance->objectiveFunction->getPreferredParent(instance->candidateParents, instance->preferredParent);
 
     if (!newPrefParent) {
         EV_WARN << "Objective function couldn't select preferred parent" << endl;
@@ -1151,13 +1959,29 @@ void Rpl::updatePrefParent()
     if (prefParentHasChanged(newPrefParentAddr)) {
         parentChanged = true;
 
-        setParentMobility(newPrefParent);
+        if (joinStartedAt >= SIMTIME_ZERO) {
+            emit(joinDelaySignal, simTime() - joinStartedAt);
+            joinStartedAt = -1;
+        }
+
+        if (instance->versionChangedAt >= SIMTIME_ZERO) {
+            emit(rejoinDelaySignal, simTime() - instance->versionChangedAt);
+            instance->versionChangedAt = -1;
+        }
+
+        // former parent is still reachable if it's not been deleted due to unreachability/poisoning
+        auto oldPrefParentAddr = instance->preferredParent ? instance->preferredParent->getSrcAddress() : Ipv6Address::UNSPECIFIED_ADDRESS;
+        auto ownTargets = getOwnTargets();
+        if (instance->storing) {
+            auto downwardTargets = getDownwardTargets();
+            ownTargets.insert(ownTargets.end(), downwardTargets.begin(), downwardTargets.end());
+        }
 
         auto newPrefParentDodagId = newPrefParent->getDodagId();
         dodagInfo.update(newPrefParent);
 
         /** Silently join new DODAG and update dest address for application, TODO: Check with RFC */
-        dodagId = newPrefParentDodagId;
+        instance->dodagId = newPrefParentDodagId;
 
         // Avoid overwriting manually set dest addresses
         for (auto app : apps)
@@ -1168,27 +1992,39 @@ void Rpl::updatePrefParent()
         clearParentRoutes();
         clearAllDaoAckTimers();
 
-        drawConnector(newPrefParent->getPosition(), newPrefParent->getColor());
-        updateRoutingTable(newPrefParentAddr, dodagId, nullptr, true);
+        updateRoutingTable(newPrefParentAddr, instance->dodagId, nullptr, true);
 
         // required for proper nextHop address resolution
-        if (newPrefParentAddr != dodagId)
+        if (newPrefParentAddr != instance->dodagId)
             updateRoutingTable(newPrefParentAddr, newPrefParentAddr, nullptr, false);
 
-        lastTransit = new Ipv6Address(newPrefParentAddr);
+        auto timeout = daoDelay * uniform(1, 7); // TODO: magic numbers
+        if (daoEnabled && instance->storing && par("noPathDaoEnabled").boolValue()
+                && oldPrefParentAddr != Ipv6Address::UNSPECIFIED_ADDRESS)
+        {
+            // former parent stays a 1-hop neighbor, keep it routable to deliver No-Path
+            updateRoutingTable(oldPrefParentAddr, oldPrefParentAddr, nullptr, false);
+            // withdraw the old path only once the new one is being advertised, otherwise
+            // No-Path tears down routes above the merge point before the new DAO gets there
+            sendNoPathDao(oldPrefParentAddr, ownTargets, timeout + daoDelay * uniform(0, 1));
+        }
+        // No-Path above carries the path sequence being withdrawn, DAOs via new parent the newer one
+        instance->pathSequence = lollipopIncrement(instance->pathSequence);
+
+        lastTransit = newPrefParentAddr;
         EV_DETAIL << "Updated preferred parent to - " << newPrefParentAddr << endl;
         numParentUpdates++;
         /**
          * Reset trickle timer due to inconsistency (preferred parent changed) detected, thus
          * maintaining higher topology reactivity and convergence rate [RFC 6550, 8.3]
          */
-        trickleTimer->reset();
+        instance->trickleTimer->reset(TRICKLE_RESET_PARENT_CHANGED);
         if (daoEnabled) {
-            auto timeout = daoDelay * uniform(1, 7);
-
-            if (storing)
-                // TODO: magic numbers
-                sendRplPacket(createDao(), DAO, newPrefParentAddr, timeout);
+            if (instance->storing) {
+                // advertise the whole sub-DODAG, since its routes are being torn down on the former branch
+                for (auto dao : createDaos(ownTargets))
+                    sendRplPacket(dao, DAO, newPrefParentAddr, timeout);
+            }
             else
                 sendRplPacket(createDao(), DAO, newPrefParentAddr, timeout, getSelfAddress(), newPrefParentAddr);
 
@@ -1196,17 +2032,17 @@ void Rpl::updatePrefParent()
                     << " advertising " << getSelfAddress() << " reachability at " << simTime() + timeout << "s" << endl;
         }
     }
-    preferredParent = newPrefParent->dup();
+    instance->preferredParent = newPrefParent->dup();
 
     // Modified: the order of these signals makes a difference for SF behavior, lets see
 
     /** Recalculate rank based on the objective function */
-    auto newRank = objectiveFunction->calcRank(preferredParent);
-    if (newRank != rank) {
-        rank = newRank;
-        EV_DETAIL << "Updated rank - " << rank << endl;
-        clearObsoleteBackupParents(backupParents);
-        emit(rankUpdatedSignal, (long) rank);
+    auto newRank = instance->objectiveFunction->calcRank(instance->preferredParent);
+    if (newRank != instance->rank) {
+        instance->rank = newRank;
+        EV_DETAIL << "Updated rank - " << instance->rank << endl;
+        clearObsoleteBackupParents(instance->backupParents);
+        emit(rankUpdatedSignal, (long) instance->rank);
     }
 
 
@@ -1219,23 +2055,148 @@ void Rpl::updatePrefParent()
             emit(uplinkSlotOffsetSignal, newPrefParent->getSlotOffset());
 
         emit(parentChangedSignal, 0, (cObject*) rplCtrlInfo);
+        emitParentSetChange(preferredParentChangedSignal, instance->preferredParent);
     }
 
+    updateFailoverParent();
 }
 
-void Rpl::clearObsoleteBackupParents(map <Ipv6Address, Dio*> &backupParents) {
-    cCanvas *canvas = getParentModule()->getParentModule()->getCanvas();
+void Rpl::updateFailoverParent()
+{
+    if (!precomputedFailover || !instance->preferredParent)
+        return;
 
-    vector<Ipv6Address> parentsToDelete;
+    std::map<Ipv6Address, Dio *> feasibleParents;
+    for (auto const &cp : instance->candidateParents)
+        if (cp.first != instance->preferredParent->getSrcAddress() && cp.second->getRank() < instance->rank
+                && cp.second->getDodagId() == instance->dodagId && cp.second->getDodagVersion() == instance->dodagVersion)
+            feasibleParents.insert(cp);
+
+    auto newFailover = feasibleParents.empty() ? nullptr
+            : instance->objectiveFunction->getPreferredParent(feasibleParents, nullptr);
+    auto oldFailoverAddr = instance->failoverParent ? instance->failoverParent->getSrcAddress() : Ipv6Address::UNSPECIFIED_ADDRESS;
+    auto newFailoverAddr = newFailover ? newFailover->getSrcAddress() : Ipv6Address::UNSPECIFIED_ADDRESS;
+
+    if (instance->isPrimary()) {
+        // default route via former failover parent is dropped, the one via the new failover parent is
+        // (re-)installed, since it might have been cleared along with routes of the former preferred parent
+        bool isInstalled = false;
+        for (int i = routingTable->getNumRoutes() - 1; i >= 0; i--) {
+            auto ri = routingTable->getRoute(i);
+            if (!isFailoverRoute(ri))
+                continue;
+            if (ri->getNextHop() == newFailoverAddr)
+                isInstalled = true;
+            else
+                routingTable->deleteRoute(ri);
+        }
 
-    for (auto bp : backupParents) {
-        if (bp.second->getRank() > rank) {
-            auto bkConnector = backupConnectors.find(bp.second->getSrcAddress());
+        if (newFailover && !isInstalled) {
+            auto route = routingTable->createRoute();
+            route->setSourceType(IRoute::MANET);
+            route->setDestination(Ipv6Address::UNSPECIFIED_ADDRESS);
+            route->setPrefixLength(0);
+            route->setNextHop(newFailoverAddr);
+            route->setInterface(getInterfaceTowards(newFailoverAddr));
+            route->setMetric(FAILOVER_ROUTE_METRIC);
+            routingTable->addRoute(route);
+            // required for nextHop address resolution
+            updateRoutingTable(newFailoverAddr, newFailoverAddr, nullptr, false);
+        }
+    }
+
+    if (oldFailoverAddr != newFailoverAddr)
+        EV_DETAIL << "Failover parent updated to " << newFailoverAddr << endl;
+    delete instance->failoverParent;
+    instance->failoverParent = newFailover ? newFailover->dup() : nullptr;
+}
+
+bool Rpl::failoverToBackupParent()
+{
+    auto failover = instance->failoverParent;
+    if (!precomputedFailover || !failover || !instance->preferredParent
+            || instance->candidateParents.find(failover->getSrcAddress()) == instance->candidateParents.end())
+        return false;
 
-            if (bkConnector != backupConnectors.end()) {
-                canvas->removeFigure((*bkConnector).second);
-                backupConnectors.erase(bkConnector);
+    auto oldParentAddr = instance->preferredParent->getSrcAddress();
+    auto newParentAddr = failover->getSrcAddress();
+    EV_DETAIL << "Preferred parent " << oldParentAddr << " unreachable, failing over to " << newParentAddr << endl;
+    emit(parentUnreachableSignal, instance->preferredParent);
+    failedParentMac = MacAddress(instance->preferredParent->getNodeId());
+
+    if (instance->isPrimary()) {
+        std::vector<Ipv6Route *> routesToDelete;
+        Ipv6Route *failoverRoute = nullptr;
+        for (int i = 0; i < routingTable->getNumRoutes(); i++) {
+            auto ri = routingTable->getRoute(i);
+            if (ri->getNextHop() == oldParentAddr)
+                routesToDelete.push_back(ri);
+            else if (isFailoverRoute(ri) && ri->getNextHop() == newParentAddr)
+                failoverRoute = ri;
+        }
+        for (auto ri : routesToDelete)
+            routingTable->deleteRoute(ri);
+        // the only "route update" required is promoting the pre-installed default route
+        if (failoverRoute)
+            failoverRoute->setMetric(0);
+        else
+            updateRoutingTable(newParentAddr, instance->dodagId, nullptr, true);
+        routingTable->purgeDestCache();
+    }
+    else {
+        auto &routes = instance->downwardRoutes;
+        for (auto it = routes.begin(); it != routes.end();) {
+            if (it->second != oldParentAddr) {
+                ++it;
+                continue;
             }
+            instance->downwardPathSequences.erase(it->first);
+            it = routes.erase(it);
+        }
+    }
+
+    instance->candidateParents.erase(oldParentAddr);
+    delete instance->preferredParent;
+    instance->preferredParent = failover;
+    instance->failoverParent = nullptr;
+    dodagInfo.update(failover);
+    emitParentSetChange(preferredParentChangedSignal, failover);
+    lastTransit = newParentAddr;
+    numParentUpdates++;
+    emit(parentFailoverSignal, 1L);
+
+    auto newRank = instance->objectiveFunction->calcRank(failover);
+    if (newRank != instance->rank) {
+        instance->rank = newRank;
+        clearObsoleteBackupParents(instance->backupParents);
+        emit(rankUpdatedSignal, (long) instance->rank);
+    }
+    emit(parentChangedSignal, 0, (cObject*) new RplGenericControlInfo(failover->getNodeId()));
+
+    if (daoEnabled) {
+        clearAllDaoAckTimers();
+        instance->pathSequence = lollipopIncrement(instance->pathSequence);
+        if (instance->storing) {
+            auto targets = getOwnTargets();
+            auto downwardTargets = getDownwardTargets();
+            targets.insert(targets.end(), downwardTargets.begin(), downwardTargets.end());
+            for (auto dao : createDaos(targets))
+                sendRplPacket(dao, DAO, newParentAddr, daoDelay * uniform(0, 1));
+        }
+        else
+            sendRplPacket(createDao(), DAO, newParentAddr, daoDelay * uniform(0, 1), getSelfAddress(), newParentAddr);
+    }
+
+    updateFailoverParent();
+    return true;
+}
+
+void Rpl::clearObsoleteBackupParents(map <Ipv6Address, Dio*> &backupParents) {
+    vector<Ipv6Address> parentsToDelete;
+
+    for (auto bp : backupParents) {
+        if (bp.second->getRank() > instance->rank) {
+            emitParentSetChange(backupParentRemovedSignal, bp.second);
             parentsToDelete.push_back(bp.second->getSrcAddress());
         }
     }
@@ -1253,7 +2214,7 @@ void Rpl::clearObsoleteBackupParents(map <Ipv6Address, Dio*> &backupParents) {
 
 bool Rpl::prefParentHasChanged(const Ipv6Address &newPrefParentAddr)
 {
-    return !preferredParent || preferredParent->getSrcAddress() != newPrefParentAddr;
+    return !instance->preferredParent || instance->preferredParent->getSrcAddress() != newPrefParentAddr;
 }
 
 //
@@ -1265,18 +2226,30 @@ RplRouteData* Rpl::prepRouteData(const Dao *dao) {
     routeData->setDodagId(dao->getDodagId());
     routeData->setInstanceId(dao->getInstanceId());
     routeData->setDtsn(dao->getSeqNum());
+    routeData->setPathSequence(dao->getPathSequence());
     routeData->setExpirationTime(-1);
     return routeData;
 }
 
-bool Rpl::updateRoutingTable(const Ipv6Address &nextHop, const Ipv6Address &dest, RplRouteData *routeData, bool defaultRoute)
+bool Rpl::updateRoutingTable(const Ipv6Address &nextHop, const Ipv6Address &dest, RplRouteData *routeData, bool defaultRoute, InterfaceEntry *ie)
 {
+    // secondary instances keep their routes aside, upward traffic simply follows the preferred parent
+    if (!instance->isPrimary()) {
+        bool isKnownDest = instance->downwardRoutes.find(dest) != instance->downwardRoutes.end();
+        if (!defaultRoute)
+            instance->downwardRoutes[dest] = nextHop;
+        if (routeData && !defaultRoute)
+            instance->downwardPathSequences[dest] = routeData->getPathSequence();
+        delete routeData;
+        return isKnownDest;
+    }
+
     bool isDuplicateRoute = false;
 
     auto route = routingTable->createRoute();
     route->setSourceType(IRoute::MANET);
     route->setPrefixLength(isRoot ? 128 : prefixLength);
-    route->setInterface(interfaceEntryPtr);
+    route->setInterface(ie);
     route->setDestination(dest);
     route->setNextHop(nextHop);
     /**
@@ -1284,7 +2257,7 @@ bool Rpl::updateRoutingTable(const Ipv6Address &nextHop, const Ipv6Address &dest
      * (i.e. not downward route, learned from DAO), set it as default route
      */
     if (defaultRoute) {
-        routingTable->addDefaultRoute(nextHop, interfaceEntryPtr->getInterfaceId(), DEFAULT_PARENT_LIFETIME);
+        routingTable->addDefaultRoute(nextHop, ie->getInterfaceId(), DEFAULT_PARENT_LIFETIME);
         EV_DETAIL << "Adding default route via " << nextHop << endl;
     }
     if (routeData)
@@ -1298,7 +2271,7 @@ bool Rpl::updateRoutingTable(const Ipv6Address &nextHop, const Ipv6Address &dest
         isDuplicateRoute = true;
 
     if (!checkDestRoutable(nextHop))
-        updateRoutingTable(nextHop, nextHop, nullptr, false);
+        updateRoutingTable(nextHop, nextHop, nullptr, false, ie);
 
     return isDuplicateRoute;
 }
@@ -1320,12 +2293,14 @@ bool Rpl::checkDuplicateRoute(Ipv6Route *route) {
         auto rtdest = rt->getDestinationAsGeneric().toIpv6();
         auto dest = route->getDestinationAsGeneric().toIpv6();
         if (dest == rtdest) {
-            if (rt->getNextHop() != route->getNextHop()) {
+            if (rt->getNextHop() != route->getNextHop() || rt->getInterface() != route->getInterface()) {
                 rt->setNextHop(route->getNextHop());
+                rt->setInterface(route->getInterface()); // destination may move between the radio and the backbone
                 EV_DETAIL << "Duplicate route, updated next hop to " << rt->getNextHop() << " for dest " << dest << endl;
-                if (route->getProtocolData())
-                    rt->setProtocolData(route->getProtocolData());
             }
+            // keep path sequence of the latest DAO even if the next hop remains the same
+            if (route->getProtocolData())
+                rt->setProtocolData(route->getProtocolData());
             return true;
         }
     }
@@ -1333,22 +2308,49 @@ bool Rpl::checkDuplicateRoute(Ipv6Route *route) {
 }
 
 void Rpl::appendRplPacketInfo(Packet *datagram) {
-    auto rpi = makeShared<RplPacketInfo>();
-    rpi->setChunkLength(B(4));
-    rpi->setDown(isRoot || isDownlinkPacket(datagram));
+    bool down = isRoot || isDownlinkPacket(datagram);
+    auto ipv6Header = removeNetworkProtocolHeader<Ipv6Header>(datagram);
+    auto rpi = new RplPacketInfo();
+    rpi->setDown(down);
     rpi->setRankError(false);
     rpi->setFwdError(false);
-    rpi->setInstanceId(instanceId);
-    rpi->setSenderRank(rank);
-    datagram->insertAtBack(rpi);
-    EV_INFO << "Appended RPL Packet Information: \n" << printHeader(rpi.get())
+    rpi->setInstanceId(instance->instanceId);
+    rpi->setSenderRank(instance->rank);
+    EV_INFO << "Appended RPL Packet Information: \n" << printHeader(rpi)
             << "\n to UDP datagram: " << datagram << endl;
+
+    auto hopByHop = dynamic_cast<Ipv6HopByHopOptionsHeader *>(ipv6Header->findExtensionHeaderByTypeForUpdate(IP_PROT_IPv6EXT_HOP));
+    if (hopByHop == nullptr) {
+        hopByHop = new Ipv6HopByHopOptionsHeader();
+        ipv6Header->addExtensionHeader(hopByHop);
+    }
+    hopByHop->getTlvOptionsForUpdate().insertTlvOption(rpi);
+    // next header and length octets followed by options, padded to 8-octet units
+    hopByHop->setByteLength(B((2 + hopByHop->getTlvOptions().getLength() + 7) / 8 * 8));
+    ipv6Header->setChunkLength(B(ipv6Header->calculateHeaderByteLength()));
+    insertNetworkProtocolHeader(datagram, Protocol::ipv6, ipv6Header);
+}
+
+const RplPacketInfo *Rpl::findRplPacketInfo(Packet *datagram) {
+    auto ipv6Header = dynamicPtrCast<const Ipv6Header>(findNetworkProtocolHeader(datagram));
+    return ipv6Header ? findRplPacketInfo(ipv6Header.get()) : nullptr;
+}
+
+const RplPacketInfo *Rpl::findRplPacketInfo(const Ipv6Header *ipv6Header) {
+    auto hopByHop = dynamic_cast<const Ipv6HopByHopOptionsHeader *>(ipv6Header->findExtensionHeaderByType(IP_PROT_IPv6EXT_HOP));
+    if (hopByHop == nullptr)
+        return nullptr;
+    int i = hopByHop->getTlvOptions().findByType(RPL_OPTION_TYPE);
+    return i < 0 ? nullptr : check_and_cast<const RplPacketInfo *>(hopByHop->getTlvOptions().getTlvOption(i));
 }
 
 bool Rpl::isDownlinkPacket(Packet *datagram) {
     auto networkProtocolHeader = findNetworkProtocolHeader(datagram);
     auto dest = networkProtocolHeader->getDestinationAddress().toIpv6();
     EV_DETAIL << "Determining packet forwarding direction:\n destination - " << dest << endl;
+    if (!instance->isPrimary())
+        return instance->downwardRoutes.find(dest) != instance->downwardRoutes.end();
+
     auto ri = routingTable->doLongestPrefixMatch(dest);
     if (ri == nullptr) {
         auto errorMsg = std::string("Error while determining packet forwarding direction"
@@ -1358,52 +2360,50 @@ bool Rpl::isDownlinkPacket(Packet *datagram) {
 
     EV_DETAIL << " next hop - " << ri->getNextHop() << endl;
     bool res = isSourceRouted(datagram)
-            || !(ri->getNextHop().matches(preferredParent->getSrcAddress(), prefixLength));
+            || !(ri->getNextHop().matches(instance->preferredParent->getSrcAddress(), prefixLength));
     EV_DETAIL << " Packet travels " << boolStr(res, "downwards", "upwards");
     return res;
 }
 
 
 bool Rpl::isSourceRouted(Packet *pkt) {
-    EV_DETAIL << "Checking if packet is source-routed" << endl;;
-    try {
-        auto srh = pkt->popAtBack<SourceRoutingHeader>(B(64));
-        EV_DETAIL << "Retrieved source-routing header - " << srh << endl;
-        return true;
-    }
-    catch (std::exception &e) { }
-
-    return false;
+    return hasHeader(pkt, RPL_HEADER_SRH);
 }
 
+uint8_t Rpl::getHeaderPresence(Packet *pkt) {
+    if (auto presenceTag = pkt->findTag<RplHeaderPresenceTag>())
+        return presenceTag->getHeaders();
 
-// TODO: update to realistic values or calculate dynamically?
-B Rpl::getDaoLength() {
-    return B(8);
+    uint8_t headers = 0;
+    if (hasTrailingChunk<SourceRoutingHeader>(pkt, getSrhSize()))
+        headers |= RPL_HEADER_SRH;
+    if (hasTrailingChunk<RplTransitInfo>(pkt, getTransitOptionLength()))
+        headers |= RPL_HEADER_TRANSIT_OPTIONS;
+    pkt->addTag<RplHeaderPresenceTag>()->setHeaders(headers);
+    return headers;
 }
 
-B Rpl::getTransitOptionsLength() {
-    return B(16);
+void Rpl::setHeaderPresence(Packet *pkt, RplHeaderType header, bool present) {
+    auto headers = getHeaderPresence(pkt);
+    pkt->addTagIfAbsent<RplHeaderPresenceTag>()->setHeaders(present ? headers | header : headers & ~header);
 }
 
-B Rpl::getRpiHeaderLength() {
-    return B(4);
-}
 
 void Rpl::appendDaoTransitOptions(Packet *pkt) {
-    appendDaoTransitOptions(pkt, getSelfAddress(), preferredParent->getSrcAddress());
+    appendDaoTransitOptions(pkt, getSelfAddress(), instance->preferredParent->getSrcAddress());
 }
 
 void Rpl::appendDaoTransitOptions(Packet *pkt, const Ipv6Address &target, const Ipv6Address &transit) {
     EV_DETAIL << "Appending target, transit options to DAO: " << pkt << endl;
     auto rplTarget = makeShared<RplTargetInfo>();
     auto rplTransit = makeShared<RplTransitInfo>();
-    rplTarget->setChunkLength(getTransitOptionsLength());
-    rplTransit->setChunkLength(getTransitOptionsLength());
+    rplTarget->setChunkLength(getTargetOptionLength());
+    rplTransit->setChunkLength(getTransitOptionLength());
     rplTarget->setTarget(target);
     rplTransit->setTransit(transit);
     pkt->insertAtBack(rplTarget);
     pkt->insertAtBack(rplTransit);
+    setHeaderPresence(pkt, RPL_HEADER_TRANSIT_OPTIONS, true);
     EV_DETAIL << "transit => target headers appended: "
             << rplTransit->getTransit() << " => " << rplTarget->getTarget() << endl;
 }
@@ -1411,101 +2411,140 @@ void Rpl::appendDaoTransitOptions(Packet *pkt, const Ipv6Address &target, const
 
 bool Rpl::checkRplRouteInfo(Packet *datagram) {
     auto dest = findNetworkProtocolHeader(datagram)->getDestinationAddress().toIpv6();
-    if (dest.matches(getSelfAddress(), prefixLength)) {
-        EV_DETAIL << "Packet reached its destination, no RPI header checking needed" << endl;
+    auto rpi = findRplPacketInfo(datagram);
+    if (rpi == nullptr) {
+        EV_DETAIL << "No RPL Packet Information present in UDP datagram, appending" << endl;
+        appendRplPacketInfo(datagram);
         return true;
     }
     EV_DETAIL << "Checking RPI header for packet " << datagram
             << " \n coming from "
             << findNetworkProtocolHeader(datagram)->getSourceAddress().toIpv6()
             << endl;
-    RplPacketInfo *rpi;
-    try {
-        rpi = const_cast<RplPacketInfo *> (datagram->popAtBack<RplPacketInfo>(B(4)).get());
-    }
-    catch (std::exception &e) {
-       EV_WARN << "No RPL Packet Information present in UDP datagram, appending" << endl;
-       try {
-           appendRplPacketInfo(datagram);
-           return true;
-       }
-       catch (...) {
-           return false;
-       }
+
+    /**
+     * Child couldn't route the datagram further down, clear outdated DAO route
+     * and discard the datagram [RFC 6550, 11.2.2.3]
+     */
+    if (rpi->getFwdError()) {
+        EV_WARN << "Packet " << datagram << " returned with forwarding error, clearing route to "
+                << dest << " and dropping" << endl;
+        deleteStaleRoute(dest);
+        return false;
     }
-    if (isRoot)
-        return true;
-    // check for rank inconsistencies
+
+    // check for rank inconsistencies, repeated one indicates a loop [RFC 6550, 11.2.2.2]
     EV_DETAIL << "Rank error before checking - " << rpi->getRankError() << endl;
     bool rankInconsistency = checkRankError(rpi);
     if (rpi->getRankError() && rankInconsistency) {
         EV_WARN << "Repeated rank error detected for packet "
-                << datagram << "\n dropping..." << endl;
+                << datagram << "\n dropping and resetting trickle timer" << endl;
+        emit(datapathLoopSignal, 1L);
+        instance->trickleTimer->reset(TRICKLE_RESET_RANK_ERROR);
         return false;
     }
-    if (rankInconsistency)
-        rpi->setRankError(rankInconsistency);
-    EV_DETAIL << "Rank error after check - " << rpi->getRankError() << endl;
+    bool rankError = rpi->getRankError() || rankInconsistency;
+    EV_DETAIL << "Rank error after check - " << rankError << endl;
+
     /**
      * If there's a forwarding error, packet should be returned to parent
-     * with 'F' flag set to clear outdated DAO routes if DAO inconsistency detection
-     * is enabled [RFC 6550, 11.2.2.3]
+     * with 'F' flag set to clear outdated DAO routes [RFC 6550, 11.2.2.3]
      */
-    rpi->setFwdError(!isRoot && checkForwardingError(rpi, dest));
-    if (rpi->getFwdError()) {
-        EV_WARN << "Forwarding error detected for packet " << datagram
+    bool fwdError = checkForwardingError(rpi, dest);
+    if (fwdError && isRoot) {
+        EV_WARN << "Forwarding error detected at the root for packet " << datagram
                 << "\n destined to " << dest << ", dropping" << endl;
         return false;
     }
-    // update packet forwarding direction if storing mode is in use
+    // update packet forwarding direction,
     // e.g. if unicast P2P packet reaches sub-dodag root with 'O' flag cleared,
     // and this root can route packet downwards to destination, 'O' flag has to be set.
-    if (storing)
-        rpi->setDown(isRoot || isDownlinkPacket(datagram));
-    // try make new shared ptr chunk RPI, to be refactored into reusing existing RPI object
-    auto rpiCopy = makeShared<RplPacketInfo>();
-    rpiCopy->setChunkLength(getRpiHeaderLength());
-    rpiCopy->setDown(rpi->getDown());
-    rpiCopy->setRankError(rpi->getRankError());
-    rpiCopy->setFwdError(rpi->getFwdError());
-    rpiCopy->setInstanceId(instanceId);
-    rpiCopy->setSenderRank(rank);
-    datagram->insertAtBack(rpiCopy);
+    bool down = fwdError ? rpi->getDown() : isRoot || isDownlinkPacket(datagram);
+
+    // the option is updated in place, within the IPv6 header owned by this datagram
+    auto ipv6Header = removeNetworkProtocolHeader<Ipv6Header>(datagram);
+    auto updatedRpi = const_cast<RplPacketInfo *>(findRplPacketInfo(ipv6Header.get()));
+    updatedRpi->setDown(down);
+    updatedRpi->setRankError(rankError);
+    updatedRpi->setFwdError(fwdError);
+    updatedRpi->setSenderRank(instance->rank);
+    insertNetworkProtocolHeader(datagram, Protocol::ipv6, ipv6Header);
+
+    if (fwdError) {
+        auto parentAddr = instance->preferredParent->getSrcAddress();
+        EV_WARN << "Forwarding error detected for packet " << datagram
+                << "\n destined to " << dest << ", returning it to the parent " << parentAddr << endl;
+        datagram->addTagIfAbsent<NextHopAddressReq>()->setNextHopAddress(parentAddr);
+        datagram->addTagIfAbsent<InterfaceReq>()->setInterfaceId(getInterfaceTowards(parentAddr)->getInterfaceId());
+        emit(forwardingErrorSignal, 1L);
+    }
     return true;
 }
 
-void Rpl::extractSourceRoutingData(Packet *pkt) {
-    try {
-        lastTransit = new Ipv6Address(pkt->popAtBack<RplTransitInfo>(getTransitOptionsLength()).get()->getTransit());
-        lastTarget = new Ipv6Address(pkt->popAtBack<RplTargetInfo>(getTransitOptionsLength()).get()->getTarget());
-        if (!isRoot)
+void Rpl::deleteStaleRoute(const Ipv6Address &dest) {
+    if (!instance->isPrimary()) {
+        instance->downwardRoutes.erase(dest);
+        instance->downwardPathSequences.erase(dest);
+        return;
+    }
+    for (int i = 0; i < routingTable->getNumRoutes(); i++) {
+        auto ri = routingTable->getRoute(i);
+        if (ri->getDestPrefix() == dest && dynamic_cast<RplRouteData *> (ri->getProtocolData())) {
+            routingTable->deleteRoute(ri);
+            routingTable->purgeDestCache();
             return;
-
-        sourceRoutingTable.insert( std::pair<Ipv6Address, Ipv6Address>(*lastTarget, *lastTransit) );
-        EV_DETAIL << "Source routing table updated with new:\n"
-                << "target: " << lastTarget << "\n transit: " << lastTransit << "\n"
-                << printMap(sourceRoutingTable) << endl;
+        }
     }
-    catch (std::exception &e) {
-        EV_WARN << "Couldn't pop RPL Target, Transit Information options from packet: "
-                << pkt << endl;
+}
+
+void Rpl::extractSourceRoutingData(Packet *pkt) {
+    if (!hasHeader(pkt, RPL_HEADER_TRANSIT_OPTIONS)) {
+        EV_DETAIL << "No RPL Target, Transit Information options in packet: " << pkt << endl;
+        return;
     }
+    lastTransit = pkt->popAtBack<RplTransitInfo>(getTransitOptionLength()).get()->getTransit();
+    lastTarget = pkt->popAtBack<RplTargetInfo>(getTargetOptionLength()).get()->getTarget();
+    setHeaderPresence(pkt, RPL_HEADER_TRANSIT_OPTIONS, false);
+    if (!isRoot)
+        return;
+
+    sourceRoutingTable.insert( std::pair<Ipv6Address, Ipv6Address>(lastTarget, lastTransit) );
+    EV_DETAIL << "Source routing table updated with new:\n"
+            << "target: " << lastTarget << "\n transit: " << lastTransit << "\n"
+            << printMap(sourceRoutingTable) << endl;
 }
 
 INetfilter::IHook::Result Rpl::checkRplHeaders(Packet *datagram) {
     // skip further checks if node doesn't belong to a DODAG
-    auto datagramName = std::string(datagram->getFullName());
-    EV_INFO << "packet fullname " << datagramName << endl;
-    if (!isRoot && (preferredParent == nullptr || dodagId == Ipv6Address::UNSPECIFIED_ADDRESS))
+    auto destAddr = findNetworkProtocolHeader(datagram)->getDestinationAddress().toIpv6();
+    if (isRplMulticastGroup(destAddr))
+        return routeMulticastGroupPacket(datagram, destAddr);
+
+    bool isUdpDatagram = isUdp(datagram);
+    instance = isUdpDatagram ? getPacketInstance(datagram) : instances.front();
+    // RPL Packet Information is discarded along with the IPv6 header at the destination
+    if (isUdpDatagram && instance->storing && destAddr.matches(getSelfAddress(), prefixLength))
+        return ACCEPT;
+
+    if (!isRoot && (instance->preferredParent == nullptr || instance->dodagId == Ipv6Address::UNSPECIFIED_ADDRESS))
     {
         EV_DETAIL << "Node is detached from a DODAG, " <<
                 " no forwarding/rank error checks will be performed" << endl;
         return ACCEPT;
     }
 
-    if (isUdp(datagram)) {
+    // datapath validation on every hop in storing mode
+    if (isUdpDatagram && instance->storing && !checkRplRouteInfo(datagram))
+        return DROP;
+
+    if (isUdpDatagram && !instance->isPrimary()) {
+        forwardOnInstance(datagram);
+        return ACCEPT;
+    }
+
+    if (isUdpDatagram) {
         // in non-storing MOP source routing header is needed for downwards traffic
-        if (!storing) {
+        if (!instance->storing) {
             // generate one if the sender is root
             if (isRoot) {
                 if (selfGeneratedPkt(datagram)) {
@@ -1528,20 +2567,142 @@ INetfilter::IHook::Result Rpl::checkRplHeaders(Packet *datagram) {
 }
 
 
+INetfilter::IHook::Result Rpl::routeMulticastGroupPacket(Packet *datagram, const Ipv6Address &group)
+{
+    instance = instances.front();
+    bool locallyOriginated = datagram->findTag<InterfaceInd>() == nullptr;
+    // unspecified interface confines the datagram to local delivery
+    auto interfaceReq = datagram->addTagIfAbsent<InterfaceReq>();
+    interfaceReq->setInterfaceId(-1);
+
+    /**
+     * Datagrams relayed by siblings, children or other neighbors are heard as well
+     * due to link-layer broadcast, only the copy from preferred parent travels further down
+     */
+    if (!locallyOriginated) {
+        auto macAddressInd = datagram->findTag<MacAddressInd>();
+        if (!instance->preferredParent || !macAddressInd
+                || macAddressInd->getSrcAddress() != MacAddress(instance->preferredParent->getNodeId()))
+        {
+            EV_DETAIL << "Multicast datagram to " << group << " not received from pref. parent, not relaying" << endl;
+            return ACCEPT;
+        }
+    }
+
+    auto memberInterfaces = getGroupInterfaces(group);
+    if (memberInterfaces.empty()) {
+        EV_DETAIL << "No members of " << group << " in the sub-DODAG, multicast datagram is not relayed" << endl;
+        emit(mcastSuppressedSignal, 1L);
+        return locallyOriginated ? DROP : ACCEPT;
+    }
+
+    // members spread over several interfaces are served by the default network layer behavior
+    if (memberInterfaces.size() > 1)
+        datagram->removeTag<InterfaceReq>();
+    else
+        interfaceReq->setInterfaceId(*memberInterfaces.begin());
+
+    EV_DETAIL << "Relaying multicast datagram to " << group << " towards members on "
+            << memberInterfaces.size() << " interface(s)" << endl;
+    emit(mcastForwardedSignal, 1L);
+    return ACCEPT;
+}
+
+std::vector<Ipv6Address> Rpl::getSubscribedGroups()
+{
+    std::vector<Ipv6Address> groups;
+    for (auto ie : rplInterfaces) {
+        auto ipv6Data = ie->getProtocolData<Ipv6InterfaceData>();
+        for (auto &group : ipv6Data->getJoinedMulticastGroups())
+            if (group.getMulticastScope() > 2 && std::find(groups.begin(), groups.end(), group) == groups.end())
+                groups.push_back(group);
+    }
+    return groups;
+}
+
+std::set<int> Rpl::getGroupInterfaces(const Ipv6Address &group)
+{
+    std::set<int> interfaceIds;
+    for (int i = 0; i < routingTable->getNumRoutes(); i++) {
+        auto ri = routingTable->getRoute(i);
+        if (ri->getDestPrefix() == group && dynamic_cast<RplRouteData *> (ri->getProtocolData()))
+            interfaceIds.insert(ri->getInterface()->getInterfaceId());
+    }
+    return interfaceIds;
+}
+
+std::vector<Ipv6Address> Rpl::getOwnTargets()
+{
+    std::vector<Ipv6Address> targets = { getSelfAddress() };
+    if (instance->multicast) {
+        auto groups = getSubscribedGroups();
+        targets.insert(targets.end(), groups.begin(), groups.end());
+    }
+    return targets;
+}
+
+RplInstance* Rpl::getPacketInstance(Packet *datagram)
+{
+    if (instances.size() == 1)
+        return instances.front();
+
+    // forwarded packets carry the instance ID in RPL Packet Information
+    if (auto rpi = findRplPacketInfo(datagram))
+        if (auto rplInstance = findInstance(rpi->getInstanceId()))
+            return rplInstance;
+
+    // locally generated ones are mapped to an instance by the destination port
+    auto ipHeader = findNetworkProtocolHeader(datagram);
+    if (!portInstances.empty() && ipHeader->getSourceAddress().toIpv6().matches(getSelfAddress(), prefixLength)) {
+        auto udpHeader = datagram->peekDataAt<UdpHeader>(ipHeader->getChunkLength());
+        auto mapping = portInstances.find(udpHeader->getDestPort());
+        if (mapping != portInstances.end())
+            return findInstance(mapping->second);
+    }
+
+    return instances.front();
+}
+
+void Rpl::forwardOnInstance(Packet *datagram)
+{
+    auto ipHeader = findNetworkProtocolHeader(datagram);
+    auto dest = ipHeader->getDestinationAddress().toIpv6();
+    if (dest.matches(getSelfAddress(), prefixLength))
+        return;
+
+    auto rpi = findRplPacketInfo(datagram);
+    if (rpi == nullptr)
+        appendRplPacketInfo(datagram);
+    // datagram with forwarding error is already headed back to the parent
+    else if (rpi->getFwdError())
+        return;
+
+    auto nextHop = instance->getNextHop(dest);
+    if (nextHop.isUnspecified()) {
+        EV_WARN << "No route to " << dest << " within RPL instance " << (int) instance->instanceId
+                << ", falling back to the routing table" << endl;
+        return;
+    }
+
+    EV_DETAIL << "Forwarding packet of RPL instance " << (int) instance->instanceId
+            << " destined to " << dest << " via " << nextHop << endl;
+    datagram->addTagIfAbsent<NextHopAddressReq>()->setNextHopAddress(nextHop);
+    datagram->addTagIfAbsent<InterfaceReq>()->setInterfaceId(getInterfaceTowards(nextHop)->getInterfaceId());
+}
+
 bool Rpl::destIsRoot(Packet *datagram) {
-    return findNetworkProtocolHeader(datagram).get()->getDestinationAddress().toIpv6().matches(dodagId, prefixLength);
+    return findNetworkProtocolHeader(datagram).get()->getDestinationAddress().toIpv6().matches(instance->dodagId, prefixLength);
 }
 
 void Rpl::saveDaoTransitOptions(Packet *dao) {
-    try {
-        lastTransit = new Ipv6Address(dao->popAtBack<RplTransitInfo>(getTransitOptionsLength()).get()->getTransit());
-        lastTarget = new Ipv6Address(dao->popAtBack<RplTargetInfo>(getTransitOptionsLength()).get()->getTarget());
-        EV_DETAIL << "Updated lastTransit => lastTarget to: " << *lastTransit << " => " << *lastTarget << endl;
-    }
-    catch (std::exception &e) {
+    if (!hasHeader(dao, RPL_HEADER_TRANSIT_OPTIONS)) {
         EV_DETAIL << "No Target, Transit headers found on packet:\n " << *dao << endl;
         return;
     }
+    lastTransit = dao->popAtBack<RplTransitInfo>(getTransitOptionLength()).get()->getTransit();
+    lastTarget = dao->popAtBack<RplTargetInfo>(getTargetOptionLength()).get()->getTarget();
+    setHeaderPresence(dao, RPL_HEADER_TRANSIT_OPTIONS, false);
+    EV_DETAIL << "Updated lastTransit => lastTarget to: " << lastTransit << " => " << lastTarget << endl;
 }
 
 void Rpl::constructSrcRoutingHeader(std::deque<Ipv6Address> &addressList, Ipv6Address dest)
@@ -1581,9 +2742,14 @@ void Rpl::appendSrcRoutingHeader(Packet *datagram) {
     srh->setAddresses(srhAddresses);
     srh->setChunkLength(getSrhSize());
     datagram->insertAtBack(srh);
+    setHeaderPresence(datagram, RPL_HEADER_SRH, true);
 }
 
 void Rpl::forwardSourceRoutedPacket(Packet *datagram) {
+    if (!isSourceRouted(datagram)) {
+        EV_WARN << "No source routing header in datagram " << datagram << endl;
+        return;
+    }
     EV_DETAIL << "processing source-routed datagram - " << datagram
             << "\n with routing header: " << endl;
     auto srh = const_cast<SourceRoutingHeader *> (datagram->popAtBack<SourceRoutingHeader>(getSrhSize()).get());
@@ -1591,6 +2757,7 @@ void Rpl::forwardSourceRoutedPacket(Packet *datagram) {
 
     if (srhAddresses.back() == getSelfAddress()) {
         EV_DETAIL << "Source-routed destination reached" << endl;
+        setHeaderPresence(datagram, RPL_HEADER_SRH, false);
         return;
     }
 
@@ -1650,26 +2817,32 @@ std::string Rpl::rplIcmpCodeToStr(RplPacketCode code) {
 }
 
 
-bool Rpl::checkRankError(RplPacketInfo *rpi) {
+bool Rpl::checkRankError(const RplPacketInfo *rpi) {
     auto senderRank = rpi->getSenderRank();
     EV_DETAIL << "Checking rank consistency: "
             << "\n direction - " << boolStr(rpi->getDown(), "down", "up")
-            << "\n senderRank - " << senderRank << "; own rank - " << rank << endl;
-    bool res = (!(rpi->getDown()) && (senderRank <= rank))
-                    || (rpi->getDown() && (senderRank >= rank));
+            << "\n senderRank - " << senderRank << "; own rank - " << instance->rank << endl;
+    bool res = (!(rpi->getDown()) && (senderRank <= instance->rank))
+                    || (rpi->getDown() && (senderRank >= instance->rank));
     EV_DETAIL << "Rank consistency check " << boolStr(res, "failed", "passed") << endl;
     return res;
 }
 
-bool Rpl::checkForwardingError(RplPacketInfo *rpi, Ipv6Address &dest) {
+bool Rpl::checkForwardingError(const RplPacketInfo *rpi, Ipv6Address &dest) {
     EV_DETAIL << "Checking forwarding error: \n MOP - "
-            << boolStr(storing, "storing", "non-storing")
+            << boolStr(instance->storing, "storing", "non-storing")
             << "\n dest - " << dest
             << "\n direction - " << boolStr(rpi->getDown(), "down", "up") << endl;
-    auto route = routingTable->doLongestPrefixMatch(dest);
-    auto parentAddr = preferredParent != nullptr ? preferredParent->getSrcAddress() : Ipv6Address::UNSPECIFIED_ADDRESS;
-    bool res = storing && rpi->getDown()
-                    && (route == nullptr || route->getNextHop().matches(parentAddr, prefixLength));
+    Ipv6Address nextHop;
+    if (instance->isPrimary()) {
+        auto route = routingTable->doLongestPrefixMatch(dest);
+        nextHop = route != nullptr ? route->getNextHop() : Ipv6Address::UNSPECIFIED_ADDRESS;
+    }
+    else
+        nextHop = instance->getNextHop(dest);
+    auto parentAddr = instance->preferredParent != nullptr ? instance->preferredParent->getSrcAddress() : Ipv6Address::UNSPECIFIED_ADDRESS;
+    bool res = instance->storing && rpi->getDown()
+                    && (nextHop.isUnspecified() || nextHop.matches(parentAddr, prefixLength));
     EV_DETAIL << "Forwarding " << boolStr(res, "error detected", "OK") << endl;
     return res;
 }
@@ -1680,7 +2853,7 @@ void Rpl::printTags(Packet *packet) {
         EV_DETAIL << "classname: " << packet->getTag(i)->getClassName() << endl;
 }
 
-std::string Rpl::printHeader(RplPacketInfo *rpi) {
+std::string Rpl::printHeader(const RplPacketInfo *rpi) {
     std::ostringstream out;
     out << " direction: " << boolStr(rpi->getDown(), "down", "up")
         << "\n senderRank:  " << rpi->getSenderRank()
@@ -1690,31 +2863,71 @@ std::string Rpl::printHeader(RplPacketInfo *rpi) {
 }
 
 
+int Rpl::redirectParentQueues(const Ipv6Address& oldParent, const MacAddress& oldParentMac, int interfaceId)
+{
+    // old parent may still be serving another instance
+    for (auto rplInstance : instances)
+        if (rplInstance->preferredParent && rplInstance->preferredParent->getSrcAddress() == oldParent)
+            return 0;
+
+    Ipv6Address newParent;
+    int newInterfaceId = -1;
+    if (instance->preferredParent) {
+        newParent = instance->preferredParent->getSrcAddress();
+        newInterfaceId = getInterfaceTowards(newParent)->getInterfaceId();
+    }
+    int numDropped = nd->redirectPendingPackets(oldParent, interfaceId, newParent, newInterfaceId);
+    EV_DETAIL << "Dropped " << numDropped << " packets awaiting resolution of unreachable parent " << oldParent << endl;
+
+    auto mac = dynamic_cast<MacProtocolBase *>(interfaceTable->getInterfaceById(interfaceId)->getSubmodule("mac"));
+    if (mac) {
+        int numFramesDropped = mac->dropQueuedFrames(oldParentMac);
+        EV_DETAIL << "Dropped " << numFramesDropped << " frames queued for unreachable parent " << oldParent << endl;
+        numDropped += numFramesDropped;
+    }
+    return numDropped;
+}
+
 void Rpl::deletePrefParent(bool poisoned)
 {
-    if (!preferredParent) {
+    if (!instance->preferredParent) {
         EV_WARN << "No preferred parent to delete" << endl;
         return;
     }
 
-    auto prefParentAddr = preferredParent->getSrcAddress();
+    auto prefParentAddr = instance->preferredParent->getSrcAddress();
     EV_DETAIL << "Preferred parent " << prefParentAddr
             << boolStr(poisoned, " detachment from DODAG", " unreachability") << " detected" << endl;
-    emit(parentUnreachableSignal, preferredParent);
+    emit(parentUnreachableSignal, instance->preferredParent);
+    if (!poisoned)
+        failedParentMac = MacAddress(instance->preferredParent->getNodeId());
     clearParentRoutes();
-    candidateParents.erase(prefParentAddr);
-    preferredParent = nullptr;
+    instance->candidateParents.erase(prefParentAddr);
+    instance->preferredParent = nullptr;
     EV_DETAIL << "Erased preferred parent from candidate parent set" << endl;
 }
 
 void Rpl::clearParentRoutes() {
-    if (!preferredParent) {
+    if (!instance->preferredParent) {
         EV_WARN << "Pref. parent not set, cannot delete associated routes from routing table " << endl;
         return;
     }
 
+    if (!instance->isPrimary()) {
+        auto &routes = instance->downwardRoutes;
+        for (auto it = routes.begin(); it != routes.end();) {
+            if (it->second != instance->preferredParent->getSrcAddress()) {
+                ++it;
+                continue;
+            }
+            instance->downwardPathSequences.erase(it->first);
+            it = routes.erase(it);
+        }
+        return;
+    }
+
     // Delete routes with prefix length 0 (default routes)
-    if (!interfaceEntryPtr) {
+    if (rplInterfaces.empty()) {
         EV_WARN << "No interface entry found, can't clear routes associated with preferred parent" << endl;
         return;
     }
@@ -1724,7 +2937,8 @@ void Rpl::clearParentRoutes() {
         return;
     }
 
-    deleteDefaultRoutes(interfaceEntryPtr->getInterfaceId());
+    for (auto ie : rplInterfaces)
+        deleteDefaultRoutes(ie->getInterfaceId());
 
     std::vector<Ipv6Route*> routesToDelete;
     auto totalRoutes = routingTable->getNumRoutes();
@@ -1732,7 +2946,7 @@ void Rpl::clearParentRoutes() {
     // Collect any remaining routes with preferred parent as the next hop
     for (int i = 0; i < totalRoutes; i++) {
         auto ri = routingTable->getRoute(i);
-        if (ri->getNextHop() == preferredParent->getSrcAddress())
+        if (ri->getNextHop() == instance->preferredParent->getSrcAddress())
             routesToDelete.push_back(ri);
     }
 
@@ -1795,6 +3009,51 @@ Ipv6Address Rpl::getSelfAddress() {
     return interfaceEntryPtr->getNetworkAddress().toIpv6();
 }
 
+void Rpl::initializeInterfaces()
+{
+    rplInterfaces.clear();
+    interfaceCosts.clear();
+    neighborInterfaces.clear();
+    cStringTokenizer prefixes(par("interfaces").stringValue());
+    std::vector<std::string> namePrefixes = prefixes.asVector();
+    for (int i = 0; i < interfaceTable->getNumInterfaces(); i++) {
+        auto ie = interfaceTable->getInterface(i);
+        for (auto &namePrefix : namePrefixes)
+            if (std::string(ie->getInterfaceName()).rfind(namePrefix, 0) == 0) {
+                rplInterfaces.push_back(ie);
+                interfaceCosts[ie->getInterfaceId()] = 1;
+                break;
+            }
+    }
+    if (rplInterfaces.empty())
+        throw cRuntimeError("No interface matching '%s' found to run RPL on", par("interfaces").stringValue());
+    interfaceEntryPtr = rplInterfaces.front();
+
+    cStringTokenizer costs(par("interfaceCosts").stringValue());
+    while (costs.hasMoreTokens()) {
+        std::string entry(costs.nextToken());
+        auto delimiter = entry.find(':');
+        auto ie = delimiter == std::string::npos ? nullptr : interfaceTable->findInterfaceByName(entry.substr(0, delimiter).c_str());
+        if (!ie || !isRplInterface(ie->getInterfaceId()))
+            throw cRuntimeError("Invalid interface cost entry '%s', expected '<RPL interface name>:<cost>'", entry.c_str());
+        interfaceCosts[ie->getInterfaceId()] = std::stoi(entry.substr(delimiter + 1));
+    }
+
+    EV_DETAIL << "RPL running on " << rplInterfaces.size() << " interface(s), default - "
+            << interfaceEntryPtr->getInterfaceName() << endl;
+}
+
+InterfaceEntry* Rpl::getInterfaceTowards(const Ipv6Address &neighborAddr)
+{
+    auto neighbor = neighborInterfaces.find(neighborAddr);
+    return neighbor != neighborInterfaces.end() ? interfaceTable->getInterfaceById(neighbor->second) : interfaceEntryPtr;
+}
+
+bool Rpl::isRplInterface(int interfaceId)
+{
+    return interfaceCosts.find(interfaceId) != interfaceCosts.end();
+}
+
 bool Rpl::checkDestKnown(const Ipv6Address &nextHop, const Ipv6Address &dest) {
     Ipv6Route *outdatedRoute = nullptr;
     for (int i = 0; i < routingTable->getNumRoutes(); i++) {
@@ -1829,7 +3088,7 @@ bool Rpl::checkDestKnown(const Ipv6Address &nextHop, const Ipv6Address &dest) {
 
 bool Rpl::checkUnknownDio(const Ptr<const Dio>& dio)
 {
-    return dio->getDodagId() != dodagId || dio->getInstanceId() != instanceId;
+    return dio->getDodagId() != instance->dodagId || dio->getInstanceId() != instance->instanceId;
 }
 
 void Rpl::addNeighbour(const Ptr<const Dio>& dio)
@@ -1845,40 +3104,26 @@ void Rpl::addNeighbour(const Ptr<const Dio>& dio)
      */
     auto dioCopy = dio->dup();
     auto dioSender = dio->getSrcAddress();
+    auto dioInterface = getInterfaceTowards(dioSender);
+    dioCopy->setInterfaceId(dioInterface->getInterfaceId());
+    dioCopy->setLinkCost(interfaceCosts.at(dioInterface->getInterfaceId()));
     /** If DIO sender has an equal rank, consider it a backup parent */
-    if (dio->getRank() == rank) {
-        if (backupParents.find(dioSender) != backupParents.end())
-            EV_DETAIL << "Backup parent entry updated - " << dioSender;
-        else
-            EV_DETAIL << "New backup parent added - " << dioSender;
-        backupParents[dioSender] = dioCopy;
+    if (dio->getRank() == instance->rank) {
+        bool isNewBackupParent = instance->backupParents.find(dioSender) == instance->backupParents.end();
+        EV_DETAIL << boolStr(isNewBackupParent, "New backup parent added - ", "Backup parent entry updated - ") << dioSender;
+        instance->backupParents[dioSender] = dioCopy;
+        if (isNewBackupParent)
+            emitParentSetChange(backupParentAddedSignal, dioCopy);
     }
     /** If DIO sender has a lower rank, consider it a candidate parent */
-    if (dio->getRank() < rank) {
-        if (candidateParents.find(dioSender) != candidateParents.end())
+    if (dio->getRank() < instance->rank) {
+        if (instance->candidateParents.find(dioSender) != instance->candidateParents.end())
             EV_DETAIL << "Candidate parent entry updated - " << dioSender;
         else
             EV_DETAIL << "New candidate parent added - " << dioSender;
-        candidateParents[dioSender] = dioCopy;
+        instance->candidateParents[dioSender] = dioCopy;
     }
     EV_DETAIL << " (rank " << dio->getRank() << ")" << endl;
-
-    // Highlight backup parents with a dashed line
-    if (pShowBackupParents)
-        drawConnector(dioSender, dio->getPosition(),  dio->getColor());
-}
-
-void Rpl::drawConnector(Ipv6Address neighborAddr, Coord pos, cFigure::Color col) {
-    cCanvas *canvas = getParentModule()->getParentModule()->getCanvas();
-    EV_DETAIL << "Canvas - " << canvas << endl;
-    if (backupConnectors.find(neighborAddr) == backupConnectors.end()) {
-        EV_DETAIL << "No connector yet found for this neighbor" << endl;
-        auto connector = new cLineFigure("backupParentConnector");
-        setParentConnectorProps(connector, pos, col, true);
-        canvas->addFigure(connector);
-        EV_DETAIL << "Connector added - " << connector << endl;
-        backupConnectors[neighborAddr] = connector;
-    }
 }
 
 //
@@ -1894,9 +3139,6 @@ void Rpl::receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj,
 
     EV_DETAIL << "Processing signal - " << signalID << endl;
 
-    if (signalID == packetReceivedSignal)
-        udpPacketsRecv++;
-
     /**
      * Upon receiving broken link signal from MAC layer, check whether
      * preferred parent is unreachable
@@ -1919,15 +3161,32 @@ void Rpl::receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj,
              * If candidate parent set is empty, leave current DODAG
              * (becoming either floating DODAG or poison child routes altogether)
              */
-            if (preferredParent && nextHop == preferredParent->getSrcAddress()
-                    && pUnreachabilityDetectionEnabled)
-            {
-                deletePrefParent();
-                // TODO: Redirect all packets already enqueued for previous pref. parent to the new one
-                // or flush the queue completely
-                updatePrefParent();
+            for (auto rplInstance : instances) {
+                instance = rplInstance;
+                auto instanceNextHop = instance->isPrimary() ? nextHop : instance->getNextHop(destination);
+                if (instance->preferredParent && instanceNextHop == instance->preferredParent->getSrcAddress()
+                        && pUnreachabilityDetectionEnabled)
+                {
+                    auto oldParent = instance->preferredParent->getSrcAddress();
+                    auto oldParentMac = MacAddress(instance->preferredParent->getNodeId());
+                    auto oldInterfaceId = getInterfaceTowards(oldParent)->getInterfaceId();
+                    if (!failoverToBackupParent()) {
+                        deletePrefParent();
+                        updatePrefParent();
+                    }
+                    if (redirectQueuedPackets) {
+                        auto numDropped = redirectParentQueues(oldParent, oldParentMac, oldInterfaceId);
+                        if (numDropped > 0)
+                            emit(parentFailureLossSignal, (long) numDropped);
+                    }
+                }
             }
         }
+
+        // the packet revealing the failure as well as those queued towards the failed parent afterwards
+        auto macAddressReq = datagram->findTag<MacAddressReq>();
+        if (macAddressReq && !failedParentMac.isUnspecified() && macAddressReq->getDestAddress() == failedParentMac)
+            emit(parentFailureLossSignal, 1L);
     }
 
 
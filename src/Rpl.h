@@ -22,8 +22,12 @@
 #ifndef _RPL_H
 #define _RPL_H
 
+#include <set>
+
 #include "TrickleTimer.h"
 #include "RplRouteData.h"
+#include "DaoAckTimeoutQueue.h"
+#include "RplInstance.h"
 #include "inet/applications/udpapp/UdpBasicApp.h"
 #include "inet/applications/udpapp/UdpSink.h"
 #include "inet/common/packet/dissector/PacketDissector.h"
@@ -32,8 +36,12 @@
 #include "inet/common/ModuleAccess.h"
 #include "inet/mobility/static/StationaryMobility.h"
 #include "inet/linklayer/common/InterfaceTag_m.h"
+#include "inet/linklayer/common/MacAddressTag_m.h"
 #include "inet/networklayer/common/L3AddressTag_m.h"
+#include "inet/networklayer/common/NextHopAddressTag_m.h"
 #include "inet/networklayer/common/L3Tools.h"
+#include "inet/networklayer/ipv6/Ipv6Header.h"
+#include "inet/transportlayer/udp/UdpHeader_m.h"
 
 using namespace std;
 
@@ -43,28 +51,6 @@ class Rpl : public RoutingProtocolBase, public cListener, public NetfilterBase::
 {
 public:
 
-    class DaoTimeoutInfo : public cObject {
-        public:
-            cMessage *timeoutPtr;
-            int numRetries;
-
-            DaoTimeoutInfo() {
-                this->timeoutPtr = nullptr;
-                this->numRetries = 0;
-            }
-
-            DaoTimeoutInfo(cMessage *timeoutPtr) {
-                this->timeoutPtr = timeoutPtr;
-                this->numRetries = 0;
-            }
-
-            friend std::ostream& operator<<(std::ostream& os, const DaoTimeoutInfo& timeoutInfo)
-            {
-                os << timeoutInfo.numRetries << " retries";
-                return os;
-            }
-    };
-
     class DodagInfo : public cObject {
 
         public:
@@ -121,8 +107,8 @@ public:
                 this->dodagId = dio->getDodagId();
                 this->prefParent = dio->getSrcAddress();
                 this->prefParentRank = dio->getRank();
-                std::string parentName(dio->getNodeName());
-                this->prefParentName = parentName;
+                auto guiTag = dio->findTag<RplGuiTag>();
+                this->prefParentName = guiTag ? guiTag->getNodeName() : "";
                 this->instanceId = dio->getInstanceId();
             }
     };
@@ -135,10 +121,11 @@ public:
     IInterfaceTable *interfaceTable;
     Ipv6RoutingTable *routingTable;
     Ipv6NeighbourDiscovery *nd;
-    InterfaceEntry *interfaceEntryPtr;
+    InterfaceEntry *interfaceEntryPtr; // first RPL interface, provides node's own address
+    std::vector<InterfaceEntry *> rplInterfaces; // interfaces RPL runs on
+    std::map<int, uint16_t> interfaceCosts; // interface ID -> link cost weighing rank increase
+    std::map<Ipv6Address, int> neighborInterfaces; // neighbor (per-interface) address -> interface ID it's reachable over
     INetfilter *networkProtocol;
-    ObjectiveFunction *objectiveFunction;
-    TrickleTimer *trickleTimer;
     cModule *host;
     cModule *udpApp;
     cModule *mac;
@@ -146,12 +133,12 @@ public:
 
     /** RPL configuration parameters and state management */
     DodagInfo dodagInfo; // for display/tracking purposes only, since WATCH_PTR on preferredParent DIO crashes
-    uint8_t dodagVersion;
-    Ipv6Address dodagId;
+    std::vector<RplInstance *> instances; // configured RPL instances, the first one is primary
+    RplInstance *instance; // instance the currently processed packet or event belongs to
+    std::map<int, uint8_t> portInstances; // UDP port -> RPL instance ID of the application traffic
     Ipv6Address selfAddr;
-    Ipv6Address *lastTarget;
-    Ipv6Address *lastTransit;
-    uint8_t instanceId;
+    Ipv6Address lastTarget; // Target, Transit options appended to non-storing mode DAOs, unspecified until known
+    Ipv6Address lastTransit;
     double daoDelay;
     double daoAckTimeout;
     double clKickoffTimeout; // timeout for auto-triggering phase II of CL SF
@@ -159,35 +146,93 @@ public:
     uint8_t daoRtxThresh;
     bool isRoot;
     bool daoEnabled;
-    bool storing;
     bool pDaoAckEnabled;
     bool hasStarted;
     bool allowDodagSwitching;
     bool pUnreachabilityDetectionEnabled;
-    bool pShowBackupParents;
+    bool precomputedFailover;
+    MacAddress failedParentMac; // last parent found unreachable, packets still queued towards it are lost as well
+    bool redirectQueuedPackets;
+    bool emitReceivedPackets;
     bool pAllowDaoForwarding;
     bool pJoinAtSinkAllowed;
-    uint16_t rank;
-    uint8_t dtsn;
     uint32_t branchChOffset;
     uint16_t branchSize;
     int daoSeqNum;
-    Dio *preferredParent;
     std::string objectiveFunctionType;
-    std::map<Ipv6Address, Dio *> backupParents;
-    std::map<Ipv6Address, Dio *> candidateParents;
     std::map<Ipv6Address, Ipv6Address> sourceRoutingTable;
-//    std::map<Ipv6Address, std::pair<cMessage *, uint8_t>> pendingDaoAcks;
-
-    std::map<Ipv6Address, DaoTimeoutInfo *> pendingDaoAcks;
+    DaoAckTimeoutQueue pendingDaoAcks; // DAO-ACK deadlines serviced by a single daoAckTimeoutEvent
+    std::map<uint8_t, std::vector<Ipv6Address>> daoAckTargets; // targets of DAOs awaiting acknowledgement, by DAO sequence number
+
+    /** DAO aggregation */
+    double daoCoalescingWindow; // time to collect targets from received DAOs before forwarding them upwards
+    int maxDaoTargets; // number of targets fitting into a single DAO frame
+    std::vector<Ipv6Address> coalescedDaoTargets; // targets awaiting to be forwarded in an aggregated DAO
+    bool coalescedDownlinkRequired;
+    bool coalescedUplinkRequired;
+    cMessage *daoCoalescingEvent;
+
+    /** DAO retransmission backoff and root congestion feedback */
+    double daoRtxBackoffCap;
+    bool daoCongestionHintEnabled;
+    int daoCongestionThresh;
+    uint8_t daoCongestionLevel; // computed locally at the root, learned from DAO-ACKs elsewhere
+    simtime_t daoCongestionLevelUpdatedAt;
+    int numDaoRxInWindow; // DAOs received by the root in the current measurement window
+    simtime_t daoRxWindowStart;
+
+    /** DTSN-driven downward route refresh [RFC 6550, 9.6] */
+    double dtsnIncrementInterval;
+    double daoRefreshJitter;
+    double daoRefreshMinInterval;
+    simtime_t lastDaoRefresh;
+    cMessage *dtsnIncrementEvent;
+    cMessage *daoRefreshEvent;
+
+    /** Global repair [RFC 6550, 8.2.2.2] */
+    double globalRepairInterval;
+    cMessage *globalRepairEvent;
+
+    /** DODAG Information Solicitation [RFC 6550, 6.2] */
+    bool disEnabled;
+    double disJitter;
+    double disInterval;
+    int maxDisAttempts;
+    int numDisAttempts;
+    std::vector<Ipv6Address> disUnicastTargets; // known neighbors to solicit DIO from directly after detaching
+    simtime_t joinStartedAt; // time of starting or detaching, -1 once a preferred parent is selected
+    cMessage *disTimeoutEvent;
+
+    /** Virtual DODAG root, multiple sinks linked by a backbone act as a single root [RFC 6550, 3.2.3] */
+    Ipv6Address virtualDodagId; // unspecified if every root advertises a DODAG of its own
+    InterfaceEntry *backboneInterface; // set on roots of a virtual DODAG only
 
     /** Statistics and control signals */
     simsignal_t dioReceivedSignal;
     simsignal_t daoReceivedSignal;
+    simsignal_t dioReceivedPacketSignal;
+    simsignal_t daoReceivedPacketSignal;
     simsignal_t parentChangedSignal;
     simsignal_t rankUpdatedSignal;
     simsignal_t parentUnreachableSignal;
     simsignal_t childJoinedSignal;
+    simsignal_t daoSentSignal;
+    simsignal_t daoBytesSentSignal;
+    simsignal_t dtsnIncrementedSignal;
+    simsignal_t daoRefreshedSignal;
+    simsignal_t dodagVersionChangedSignal;
+    simsignal_t rejoinDelaySignal;
+    simsignal_t joinDelaySignal;
+    simsignal_t disSentSignal;
+    simsignal_t parentFailoverSignal;
+    simsignal_t parentFailureLossSignal;
+    simsignal_t mcastForwardedSignal;
+    simsignal_t mcastSuppressedSignal;
+    simsignal_t datapathLoopSignal;
+    simsignal_t forwardingErrorSignal;
+    simsignal_t preferredParentChangedSignal; // changes of the primary instance's parent set for observers, e.g. RplDodagVisualizer
+    simsignal_t backupParentAddedSignal;
+    simsignal_t backupParentRemovedSignal;
 
     int numDaoDropped;
 
@@ -200,13 +245,13 @@ public:
     bool isMobile;
     uint8_t detachedTimeout; // temporary variable to suppress msg processing after just leaving the DODAG
     cMessage *detachedTimeoutEvent; // temporary msg corresponding to triggering above functionality
-    cMessage *daoAckTimeoutEvent; // temporary msg corresponding to triggering above functionality
+    cMessage *daoAckTimeoutEvent; // fires at the earliest deadline in pendingDaoAcks
     uint8_t prefixLength;
     Coord position;
     uint64_t selfId;    // Primary IE MAC address in decimal
     std::vector<cFigure::Color> colorPalette;
-    int udpPacketsRecv;
     cFigure::Color dodagColor;
+    bool guiInfoEnabled; // attach RplGuiTag to DIOs, only if there's an observer drawing the DODAG
     double currentFrequency; // stores current frequency reported by MAC
 
     // Low-latency params, only for use in 6TiSCH
@@ -231,19 +276,33 @@ public:
     static std::string boolStr(bool cond, std::string positive, std::string negative);
     static std::string boolStr(bool cond) { return boolStr(cond, "true", "false"); }
 
-    /** Search for a submodule of @param host by its name @param sname */
-    cModule* findSubmodule(std::string sname, cModule *host);
+    /** Check whether the trailing chunk of @param pkt is a header of type T and @param length, without throwing */
+    template <typename T>
+    static bool hasTrailingChunk(Packet *pkt, b length) {
+        return pkt->getDataLength() >= length && dynamicPtrCast<const T>(pkt->peekAtBack(length)) != nullptr;
+    }
 
     int numParentUpdates;
     int numDaoForwarded;
 
+    /**
+     * Increment DTSN of the primary instance and reset its trickle timer to quickly propagate it,
+     * causing the sub-DODAG to re-send DAOs and rebuild downward routes [RFC 6550, 9.6]
+     */
+    void refreshDownwardRoutes();
+
+    /**
+     * Increment DODAG version of every instance rooted at this node, making
+     * the whole DODAG rebuild itself from scratch (global repair) [RFC 6550, 8.2.2.2]
+     */
+    void globalRepair();
+
     virtual void finish() override;
 
   protected:
     /** module interface */
     void initialize(int stage) override;
     void handleMessageWhenUp(cMessage *message) override;
-    virtual void refreshDisplay() const override;
 
   private:
     void processSelfMessage(cMessage *message);
@@ -260,6 +319,39 @@ public:
     void sendPacket(cPacket *packet, double delay);
     void processPacket(Packet *packet);
 
+    /**
+     * Peek RPL message body as the type corresponding to the ICMPv6 code,
+     * so that serialized packets are restored by the matching deserializer
+     *
+     * @param packet RPL packet with the RPL header already popped
+     * @param code ICMPv6 code of the RPL header
+     * @return RPL message body
+     */
+    const Ptr<const RplPacket> peekRplBody(Packet *packet, RplPacketCode code);
+
+    /**
+     * Create RPL instances listed in 'instanceIds' parameter, each with its own
+     * objective function and trickle timer connected via 'ttModule' gate vector
+     */
+    void initializeInstances();
+
+    /** @return configured RPL instance with given ID, nullptr if the node doesn't participate in it */
+    RplInstance* findInstance(uint8_t instanceId);
+
+    /**
+     * Determine RPL instance of a data packet, either from its RPL Packet Information
+     * or, for locally generated packets, by the 'instancePorts' destination port mapping
+     *
+     * @return matching instance, primary one if no other applies
+     */
+    RplInstance* getPacketInstance(Packet *datagram);
+
+    /**
+     * Steer packet of a secondary RPL instance towards its next hop within that instance
+     * by requesting the next hop from the network layer explicitly
+     */
+    void forwardOnInstance(Packet *datagram);
+
     /**
      * Process message from trickle timer to start DIO broadcast
      *
@@ -296,6 +388,157 @@ public:
      * @param dao DAO packet object for processing
      */
     void processDao(const Ptr<const Dao>& dao);
+
+    /**
+     * Queue targets for upward forwarding in an aggregated DAO, flushing immediately
+     * once the frame size limit is reached or otherwise after the coalescing window expires
+     *
+     * @param targets destinations learned from a received DAO
+     * @param downlinkRequired, uplinkRequired TSCH bandwidth flags of the received DAO
+     */
+    void coalesceDaoTargets(const std::vector<Ipv6Address> &targets, bool downlinkRequired, bool uplinkRequired);
+
+    /** Forward all coalesced targets to the preferred parent in as few DAOs as the frame size allows */
+    void flushCoalescedDaoTargets();
+
+    /**
+     * Get all destinations advertised by a (possibly aggregated) DAO
+     *
+     * @param dao DAO or DAO-ACK packet
+     * @return reachable destination followed by any additional known targets
+     */
+    std::vector<Ipv6Address> getDaoTargets(const Dao *dao);
+
+    /**
+     * Set destinations advertised by a DAO and adjust its length accordingly
+     *
+     * @param dao DAO or DAO-ACK packet
+     * @param targets non-empty list of destinations, the first one becomes reachableDest
+     */
+    void setDaoTargets(const Ptr<Dao>& dao, const std::vector<Ipv6Address> &targets);
+
+    /**
+     * Create as few DAOs as the frame size allows to advertise given destinations,
+     * targets sharing a Transit option are grouped by their path sequence
+     *
+     * @param targets non-empty list of destinations to advertise
+     * @return DAOs with the targets split among them
+     */
+    std::vector<Ptr<Dao>> createDaos(const std::vector<Ipv6Address> &targets);
+
+    /**
+     * Binary exponential backoff with jitter for DAO retransmissions,
+     * capped and scaled by the current DODAG congestion level
+     *
+     * @param numRetries retransmissions performed so far
+     * @return delay before sending the next DAO attempt
+     */
+    double getDaoRtxBackoff(int numRetries);
+
+    /**
+     * Current DAO congestion level, learned value is halved every
+     * DAO-ACK timeout period since it's been received
+     */
+    uint8_t getDaoCongestionLevel();
+
+    /** Account for received DAO to estimate root load */
+    void updateDaoCongestionLevel();
+
+    /**
+     * React to DTSN increment of the preferred parent by scheduling DAO refresh
+     * within a random jitter, at most once per daoRefreshMinInterval
+     */
+    void scheduleDaoRefresh();
+
+    /** Re-advertise own address to the preferred parent upon DTSN increment */
+    void sendDaoRefresh();
+
+    /** Periodic DTSN increment at the root or, if enabled, storing-mode routers */
+    void processDtsnIncrementTimer();
+
+    /**
+     * Migrate to a newer DODAG version advertised in a DIO by dropping parent sets
+     * and rank of the previous version, so that parents are selected only among
+     * nodes that have already migrated, which prevents loops [RFC 6550, 8.2.2.2]
+     *
+     * @param dio DIO advertising the new version
+     */
+    void joinNewDodagVersion(const Ptr<const Dio>& dio);
+
+    /**
+     * Process No-Path DAO by removing routes to advertised targets through its sender
+     * and propagating the No-Path further up the former branch [RFC 6550, 9.8]
+     *
+     * @param dao No-Path DAO (path lifetime 0)
+     */
+    void processNoPathDao(const Ptr<const Dao>& dao);
+
+    /**
+     * Send No-Path DAO to the former preferred parent to tear down downward
+     * routes along the old branch after a parent switch
+     *
+     * @param oldParentAddr address of the former preferred parent
+     * @param targets own address and destinations from the sub-DODAG
+     * @param delay send delay, shall exceed the one of DAO to the new parent
+     */
+    void sendNoPathDao(const Ipv6Address &oldParentAddr, const std::vector<Ipv6Address> &targets, double delay);
+
+    /** Get destinations of the sub-DODAG learned from DAOs (storing mode) */
+    std::vector<Ipv6Address> getDownwardTargets();
+
+    /**
+     * Get Transit path sequence to advertise a destination with, own targets carry
+     * the one of the instance, others the one stored along with the downward route
+     */
+    uint8_t getPathSequence(const Ipv6Address &dest);
+
+    /**
+     * Check whether Transit information for a destination is older than the one
+     * its downward route has been learned from, so that delayed DAOs (No-Path ones
+     * in particular) don't override a newer path [RFC 6550, 9.2.2]
+     */
+    bool isStalePathSequence(const Ipv6Address &dest, uint8_t pathSequence);
+
+    /**
+     * Look up Transit path sequence stored along with the downward route to a destination
+     *
+     * @return true if there's such route
+     */
+    bool findStoredPathSequence(const Ipv6Address &dest, uint8_t &pathSequence);
+
+    /**
+     * Delete downward route to a destination, if it goes through the given next hop
+     *
+     * @return true if the route was found and deleted
+     */
+    bool deleteDaoRoute(const Ipv6Address &dest, const Ipv6Address &nextHop);
+
+    /**
+     * Join a virtual DODAG: adopt its ID as an extra (anycast) address, so that traffic
+     * towards the DODAG root terminates at whichever sink it reaches first,
+     * and announce own address to the other roots over the backbone
+     */
+    void initializeVirtualRoot();
+
+    bool isVirtualRoot() { return isRoot && backboneInterface != nullptr; }
+
+    /**
+     * Propagate downward routes (or their removal) learned by this root to
+     * the other roots of the virtual DODAG via link-local multicast on the backbone
+     *
+     * @param targets destinations reachable via this root
+     * @param pathLifetime NO_PATH_LIFETIME to withdraw the routes
+     */
+    void shareDaoRoutes(const std::vector<Ipv6Address> &targets, uint8_t pathLifetime);
+
+    /**
+     * Install (or withdraw) routes advertised by another root of the virtual DODAG,
+     * pointing to that root over the backbone
+     *
+     * @param dao DAO shared over the backbone
+     * @param peerAddr link-local backbone address of the advertising root
+     */
+    void processBackboneDao(const Ptr<const Dao>& dao, const Ipv6Address &peerAddr);
 //    void retransmitDao(Dao *dao);
     void retransmitDao(Ipv6Address advDest);
 
@@ -314,15 +557,22 @@ public:
      * @param code icmpv6-based control code used for RPL packets, [RFC 6550, 6]
      * @param nextHop next hop for the RPL packet to be sent out to (unicast DAO, broadcast DIO, DIS)
      * @param delay transmission delay before sending packet from outgoing gate
+     * @param interfaceName outgoing interface for multicast, empty - interface towards the unicast next hop
      */
-    void sendRplPacket(const Ptr<RplPacket>& body, RplPacketCode code, const L3Address& nextHop, double delay, const Ipv6Address &target, const Ipv6Address &transit, std::string interfaceName);
-    void sendRplPacket(const Ptr<RplPacket>& body, RplPacketCode code, const L3Address& nextHop, double delay, const Ipv6Address &target, const Ipv6Address &transit)
+    void sendRplPacket(const Ptr<const RplPacket>& body, RplPacketCode code, const L3Address& nextHop, double delay, const Ipv6Address &target, const Ipv6Address &transit, std::string interfaceName);
+    void sendRplPacket(const Ptr<const RplPacket>& body, RplPacketCode code, const L3Address& nextHop, double delay, const Ipv6Address &target, const Ipv6Address &transit)
     {
-        sendRplPacket(body, code, nextHop, delay, target, transit, "wlan");
+        sendRplPacket(body, code, nextHop, delay, target, transit, "");
     }
 
-    void sendRplPacket(const Ptr<RplPacket>& body, RplPacketCode code, const L3Address& nextHop, double delay);
-    void sendRplPacket(const Ptr<RplPacket>& body, RplPacketCode code, const L3Address& nextHop, double delay, std::string interfaceName);
+    void sendRplPacket(const Ptr<const RplPacket>& body, RplPacketCode code, const L3Address& nextHop, double delay);
+    void sendRplPacket(const Ptr<const RplPacket>& body, RplPacketCode code, const L3Address& nextHop, double delay, std::string interfaceName);
+
+    /**
+     * Multicast RPL packet (DIO, DIS) to all nodes on every RPL interface,
+     * each copy carrying sender address of the respective interface
+     */
+    void multicastRplPacket(const Ptr<const RplPacket>& body, RplPacketCode code, double delay);
 
 
     /**
@@ -331,7 +581,58 @@ public:
      * @return initialized DIO packet object
      */
     const Ptr<Dio> createDio();
-    B getDioSize() { return b(128); }
+
+    /**
+     * Get DIO to be advertised on the interface, reusing the one sent last time
+     * as long as rank, DODAG, version, DTSN and parent color stay the same
+     *
+     * @param ie RPL interface the DIO is sent on
+     * @return shared immutable DIO
+     */
+    const Ptr<const Dio>& getDio(InterfaceEntry *ie);
+
+    /** @return true if cached @param dio still matches the advertised state of the instance */
+    bool isDioUpToDate(const Dio *dio);
+    Ipv6Address getAdvertisedDodagId();
+    uint8_t getAdvertisedMop();
+    cFigure::Color getAdvertisedColor();
+
+    /** DODAG color advertised by @param dio, available only if the sender has GUI info enabled (@see RplGuiTag) */
+    cFigure::Color getNeighborColor(const Dio *dio) const;
+
+    /** Multicast DIO of the current instance on every RPL interface */
+    void multicastDio(double delay);
+    B getDioSize() { return B(RPL_DIO_BASE_LENGTH + RPL_DODAG_CONFIG_OPTION_LENGTH + RPL_PREFIX_INFO_OPTION_LENGTH); }
+
+    /**
+     * Create DIS packet soliciting DIOs from neighbors
+     *
+     * @return initialized DIS packet object
+     */
+    const Ptr<Dis> createDis();
+    B getDisSize() { return B(RPL_DIS_BASE_LENGTH); }
+
+    /**
+     * Schedule DIS to be sent within a random jitter, restarting solicitation attempts
+     *
+     * @param delay minimum delay before sending DIS
+     */
+    void scheduleDis(double delay);
+
+    /**
+     * Send DIS unicast to the known neighbors, if any, multicast otherwise,
+     * and reschedule next attempt until the node joins a DODAG
+     */
+    void sendDis();
+
+    /**
+     * Process DIS, resetting trickle timer upon multicast DIS
+     * and answering unicast one with a DIO right away [RFC 6550, 8.3]
+     *
+     * @param dis DIS packet
+     * @param destAddr destination address of the IPv6 packet carrying DIS
+     */
+    void processDis(const Ptr<const Dis>& dis, const L3Address &destAddr);
 
     /**
      * Create DAO packet advertising destination reachability
@@ -343,13 +644,22 @@ public:
     const Ptr<Dao> createDao(const Ipv6Address &reachableDest, bool ackRequired);
     const Ptr<Dao> createDao() {return createDao(getSelfAddress()); };
 
+    /**
+     * Create DAO-ACK echoing sequence number of the acknowledged DAO
+     *
+     * @param dao DAO to acknowledge
+     * @return initialized DAO-ACK packet object
+     */
+    const Ptr<DaoAck> createDaoAck(const Ptr<const Dao>& dao);
+
     /**
      * Update routing table with new route to destination reachable via next hop
      *
      * @param nextHop next hop address to reach the destination for findBestMatchingRoute()
      * @param dest discovered destination address being added to the routing table
      */
-    bool updateRoutingTable(const Ipv6Address &nextHop, const Ipv6Address &dest, RplRouteData *routeData, bool defaultRoute);
+    bool updateRoutingTable(const Ipv6Address &nextHop, const Ipv6Address &dest, RplRouteData *routeData, bool defaultRoute, InterfaceEntry *ie);
+    bool updateRoutingTable(const Ipv6Address &nextHop, const Ipv6Address &dest, RplRouteData *routeData, bool defaultRoute) { return updateRoutingTable(nextHop, dest, routeData, defaultRoute, getInterfaceTowards(nextHop)); };
     bool updateRoutingTable(const Ipv6Address &nextHop, const Ipv6Address &dest, RplRouteData *routeData) { return updateRoutingTable(nextHop, dest, routeData, false); };
 //    void updateRoutingTable(const Dao *dao);
     RplRouteData* prepRouteData(const Dao *dao);
@@ -392,6 +702,42 @@ public:
      */
     void updatePrefParent();
 
+    /**
+     * Precompute failover parent, the best feasible candidate (lower rank than ours, same DODAG
+     * version) other than the preferred parent, and pre-install default route via it
+     * at lower priority (FAILOVER_ROUTE_METRIC)
+     */
+    void updateFailoverParent();
+
+    /** @return true if @param route is the default route pre-installed via failover parent */
+    bool isFailoverRoute(Ipv6Route *route) const
+    {
+        return route->getPrefixLength() == 0 && route->getSourceType() == IRoute::MANET
+                && route->getMetric() == FAILOVER_ROUTE_METRIC;
+    }
+
+    /**
+     * Replace unreachable preferred parent by the precomputed failover parent
+     * without rebuilding routes or resetting trickle timer, the pre-installed
+     * default route is promoted and DAO is sent to the new parent
+     *
+     * @return false if no valid failover parent is available
+     */
+    bool failoverToBackupParent();
+
+    /**
+     * Deal with packets still queued towards an unreachable parent once a new
+     * one is selected: those awaiting address resolution in neighbor discovery are
+     * redirected to the new preferred parent (or dropped if there is none), frames
+     * already enqueued at the MAC are dropped rather than burning retransmissions
+     *
+     * @param oldParent link-local address of the unreachable parent
+     * @param oldParentMac its MAC address
+     * @param interfaceId interface it was reachable on
+     * @return number of dropped packets
+     */
+    int redirectParentQueues(const Ipv6Address& oldParent, const MacAddress& oldParentMac, int interfaceId);
+
     /************ Lifecycle ****************/
 
     virtual void handleStartOperation(LifecycleOperation *operation) override { start(); }
@@ -422,6 +768,22 @@ public:
      */
     Ipv6Address getSelfAddress();
 
+    /**
+     * Find interfaces matching 'interfaces' parameter and their link costs,
+     * the first match becomes the default interface
+     */
+    void initializeInterfaces();
+
+    /**
+     * Get interface a neighbor has last been heard on
+     *
+     * @param neighborAddr interface-specific address of the neighbor
+     * @return interface to reach the neighbor over, default RPL interface if neighbor is unknown
+     */
+    InterfaceEntry* getInterfaceTowards(const Ipv6Address &neighborAddr);
+
+    bool isRplInterface(int interfaceId);
+
     /**
      * Check if node's preferred parent has changed after recalculating via
      * objective function to determine whether routing table updates are necessary
@@ -487,7 +849,7 @@ public:
      * @param rpi RPL Packet Information object
      * @return string containing packet info
      */
-    std::string printHeader(RplPacketInfo *rpi);
+    std::string printHeader(const RplPacketInfo *rpi);
 
     /** Loop detection */
 
@@ -498,7 +860,7 @@ public:
      * @param rpi RPL Route Infomration header to check for
      * @return true if ther's mismatched rank relationship, false otherwise
      */
-    bool checkRankError(RplPacketInfo *rpi);
+    bool checkRankError(const RplPacketInfo *rpi);
 
     /**
      * Check RPL Packet Information header to spot a forwarding error in storing mode
@@ -508,28 +870,29 @@ public:
      * @param dest destination address retrieved from packet IP header
      * @return true if forwarding error detected, false otherwise
      */
-    bool checkForwardingError(RplPacketInfo *rpi, Ipv6Address &dest);
+    bool checkForwardingError(const RplPacketInfo *rpi, Ipv6Address &dest);
 
     /**
-     * Get default length of Target/Transit option headers
-     * @return predefined default byte value
+     * Get length of Target/Transit option headers appended in non-storing mode
      */
-    B getTransitOptionsLength();
+    B getTargetOptionLength() { return B(RPL_TARGET_OPTION_LENGTH); }
+    B getTransitOptionLength() { return B(RPL_TRANSIT_PARENT_OPTION_LENGTH); }
 
     /**
-     * Get default length of Target/Transit option headers
-     *
-     * @return predefined default byte value
+     * Get length of DAO (DAO-ACK) on the wire, depending on the number of advertised targets
+     * and presence of DODAGID
      */
-    B getRpiHeaderLength();
-    B getDaoLength();
+    B getDaoLength(const Dao *dao);
 
     // TODO: replace by dynamic calculation based on the number of addresses in source routing header
     // + additional field specifying length of this header to allow proper decapsulation
-    B getSrhSize() { return B(64); }
+    B getSrhSize() { return B(RPL_SRH_LENGTH); }
 
-    bool isDao(Packet *pkt) { return std::string(pkt->getFullName()).find("Dao") != std::string::npos; }
-    bool isUdp(Packet *datagram) { return std::string(datagram->getFullName()).find("Udp") != std::string::npos; }
+    bool isDao(Packet *pkt) { return isRplPacket(pkt) && pkt->peekAtFront<RplHeader>()->getIcmpv6Code() == DAO; }
+    bool isUdp(Packet *datagram) {
+        auto ipv6Header = dynamicPtrCast<const Ipv6Header>(findNetworkProtocolHeader(datagram));
+        return ipv6Header && ipv6Header->getProtocolId() == IP_PROT_UDP;
+    }
 
     /**
      * Used by sink to collect Transit -> Target reachability information
@@ -548,8 +911,8 @@ public:
     bool isDownlinkPacket(Packet *datagram);
 
     /**
-     * Append RPL Packet Information header to outgoing packet,
-     * captured by Netfilter hook
+     * Add RPL Packet Information as an option of IPv6 Hop-by-Hop header
+     * to outgoing packet, captured by Netfilter hook
      *
      * @param datagram outgoing UDP packet
      */
@@ -564,6 +927,36 @@ public:
      */
     Result checkRplHeaders(Packet *datagram);
 
+    /**
+     * Relay multicast datagram to the sub-DODAG in storing mode with multicast (MOP 3) [RFC 6550, 9.10].
+     * Only datagrams originated locally or received from the preferred parent are relayed,
+     * and only if DAOs of some child advertised group membership. A single link-layer
+     * broadcast serves all children on the interface, so datagram gets replicated
+     * only where branches with group members diverge.
+     *
+     * @param datagram multicast datagram catched by Netfilter hook
+     * @param group destination multicast group
+     * @return DROP for locally originated datagrams without any group member, ACCEPT otherwise
+     */
+    Result routeMulticastGroupPacket(Packet *datagram, const Ipv6Address &group);
+
+    /** @return true if datagram to @param dest is subject to MOP 3 multicast routing */
+    bool isRplMulticastGroup(const Ipv6Address &dest) {
+        return dest.isMulticast() && dest.getMulticastScope() > 2 && instances.front()->multicast;
+    }
+
+    /** @return multicast groups (larger than link-local scope) joined by local applications */
+    std::vector<Ipv6Address> getSubscribedGroups();
+
+    /** @return interfaces towards children advertising membership of the multicast group */
+    std::set<int> getGroupInterfaces(const Ipv6Address &group);
+
+    /**
+     * @return targets advertised in node's own DAO: own address and,
+     * in storing mode with multicast, multicast groups joined locally
+     */
+    std::vector<Ipv6Address> getOwnTargets();
+
     /**
      * Append Target and Transit option headers representing
      * child->parent relationship, required for source-routing
@@ -574,15 +967,41 @@ public:
     void appendDaoTransitOptions(Packet *pkt);
 
     /**
-     * Check RPL Packet Information header for loop detection purposes [RFC6550, 11.2]
+     * Validate datapath using RPL Packet Information header of a datagram being forwarded
+     * in storing mode [RFC6550, 11.2]. RPI is appended if missing (e.g. locally originated datagram),
+     * otherwise sender rank is checked against own rank given the direction flag. Repeated rank error
+     * drops the datagram and resets trickle timer, missing downward route returns the datagram
+     * to the preferred parent with 'F' flag set, and such a datagram makes the parent clear the stale route.
      *
      * @param datagram application data to check RPL headers for
-     * @return
+     * @return false if datagram has to be dropped
      */
     bool checkRplRouteInfo(Packet *datagram);
 
+    /**
+     * Find RPL Option in the Hop-by-Hop header of a datagram
+     *
+     * @return RPL Packet Information or nullptr if not present
+     */
+    const RplPacketInfo *findRplPacketInfo(Packet *datagram);
+    const RplPacketInfo *findRplPacketInfo(const Ipv6Header *ipv6Header);
+
+    /**
+     * Remove downward route to a destination, that turned out to be stale due to forwarding error
+     * reported by the child [RFC6550, 11.2.2.3]
+     */
+    void deleteStaleRoute(const Ipv6Address &dest);
+
     bool checkDuplicateRoute(Ipv6Route *route);
 
+    /**
+     * Get optional trailing RPL headers present in a packet as RplHeaderType bitmap,
+     * peeked on the first call and cached in RplHeaderPresenceTag afterwards
+     */
+    uint8_t getHeaderPresence(Packet *pkt);
+    bool hasHeader(Packet *pkt, RplHeaderType header) { return getHeaderPresence(pkt) & header; }
+    void setHeaderPresence(Packet *pkt, RplHeaderType header, bool present);
+
     /**
      * Check if packet has source-routing header (SRH) present
      * @param pkt packet to check for
@@ -638,30 +1057,34 @@ public:
     void clearDaoAckTimer(Ipv6Address daoDest);
     void clearAllDaoAckTimers();
 
+    /**
+     * Retransmit DAOs for all expired entries in pendingDaoAcks
+     * and reschedule timeout event to the next earliest deadline
+     */
+    void processDaoAckTimeout();
+
+    /** (Re)schedule daoAckTimeoutEvent to the earliest pending DAO-ACK deadline, if any */
+    void updateDaoAckTimer();
+
     std::vector<Ipv6Address> getNearestChildren();
     int getNumDownlinks();
 
     /** Misc */
-    void drawConnector(Coord target, cFigure::Color col, Ipv6Address backupParent) const;
-    void drawConnector(Coord target, cFigure::Color col) const
-    {
-        drawConnector(target, col, Ipv6Address::UNSPECIFIED_ADDRESS);
-    }
-    void drawConnector(Ipv6Address neighborAddr, Coord pos, cFigure::Color col);
+    static int getNodeId(std::string nodeName);
 
-    void setParentConnectorProps(cLineFigure *connector, Coord target, cFigure::Color col, bool dashed) const;
-    void setParentConnectorProps(cLineFigure *connector, Coord target, cFigure::Color col) const
+    /**
+     * Notify observers about a change of the primary instance's parent set, the check
+     * for listeners keeps batch runs without visualization free of this bookkeeping
+     *
+     * @param signal one of preferredParentChanged, backupParentAdded, backupParentRemoved
+     * @param dio DIO of the affected neighbor, nullptr if preferred parent is lost
+     */
+    void emitParentSetChange(simsignal_t signal, Dio *dio)
     {
-        setParentConnectorProps(connector, target, col, false);
+        if (instance->isPrimary() && mayHaveListeners(signal))
+            emit(signal, dio);
     }
 
-    static int getNodeId(std::string nodeName);
-
-    mutable cLineFigure *prefParentConnector;
-
-    // map of pointers to the dashed connector line between a node and its backup parents
-    mutable map<Ipv6Address, cLineFigure*> backupConnectors;
-
     virtual void eraseBackupParentList(map <Ipv6Address, Dio*> &backupParents);
     virtual void clearObsoleteBackupParents(map <Ipv6Address, Dio*> &backupParents);
 
@@ -669,12 +1092,8 @@ public:
 
     string hostName; // name of the host module, e.g. "host" or "sink" etc.
 
-    IMobility *parentMobilityMod; // preferred parent mobility module
     IMobility *mobility;
 
-    // look for mobility module of the parent, if it's mobile, to dynamically update the connection arrow
-    void setParentMobility(Dio* prefParent);
-
     /** Pick random color for parent-child connector drawing (if node's sink) */
     cFigure::Color pickRandomColor();
 
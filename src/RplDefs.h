@@ -30,6 +30,42 @@ namespace inet {
 #define RPL_DEFAULT_INSTANCE 1
 #define DEFAULT_INIT_DODAG_VERSION 0
 #define DEFAULT_DAO_DELAY 1
+#define NO_PATH_LIFETIME 0x00
+#define INFINITE_PATH_LIFETIME 0xFF
+#define MAX_DAO_CONGESTION_LEVEL 7
+#define DAO_ACK_MIN_TIMEOUT SimTime(1, SIMTIME_MS) // lower bound of DAO-ACK timeout, expired entries never fire within the same instant
+
+/** Mode of operation advertised in DIO [RFC 6550, 6.3.1] */
+enum RPL_MOP {
+    MOP_NO_DOWNWARD_ROUTES,
+    MOP_NON_STORING,
+    MOP_STORING_NO_MULTICAST,
+    MOP_STORING_MULTICAST
+};
+
+/** Lollipop sequence counters (DTSN, DODAG version, DAO sequence) [RFC6550, 7.2] */
+#define LOLLIPOP_CIRCULAR_REGION 127
+#define LOLLIPOP_SEQUENCE_WINDOW 16
+
+/** Increment sequence counter, wrapping from 255 into the circular region */
+inline uint8_t lollipopIncrement(uint8_t value)
+{
+    return value > LOLLIPOP_CIRCULAR_REGION ? (uint8_t) (value + 1) : (value + 1) & LOLLIPOP_CIRCULAR_REGION;
+}
+
+/** @return true if sequence counter @param a is newer than @param b */
+inline bool lollipopGreater(uint8_t a, uint8_t b)
+{
+    if (a > LOLLIPOP_CIRCULAR_REGION && b <= LOLLIPOP_CIRCULAR_REGION)
+        return 256 + b - a > LOLLIPOP_SEQUENCE_WINDOW;
+    if (a <= LOLLIPOP_CIRCULAR_REGION && b > LOLLIPOP_CIRCULAR_REGION)
+        return 256 + a - b <= LOLLIPOP_SEQUENCE_WINDOW;
+    if (a > LOLLIPOP_CIRCULAR_REGION)
+        return a > b;
+    // both in the circular region, compare within half of its span
+    auto diff = (a - b) & LOLLIPOP_CIRCULAR_REGION;
+    return diff != 0 && diff <= (LOLLIPOP_CIRCULAR_REGION + 1) / 2;
+}
 
 /** Trickle timer params [RFC6550, 8.3.1] */
 #define DEFAULT_DIO_INTERVAL_MIN 0x03
@@ -41,18 +77,64 @@ namespace inet {
 
 /** Misc */
 #define DEFAULT_PARENT_LIFETIME 5000
+#define RPL_OPTION_TYPE 0x63 // RPL Option in IPv6 Hop-by-Hop header [RFC 6553]
+#define RPL_OPTION_LENGTH 6 // option type and length octets included
+#define DEFAULT_ROUTE_METRIC 10 // metric of default routes installed by Ipv6RoutingTable::addDefaultRoute()
+#define FAILOVER_ROUTE_METRIC (DEFAULT_ROUTE_METRIC + 1) // default route via precomputed failover parent loses to the one via preferred parent
 const Ipv6Address LL_RPL_MULTICAST("FF02:0:0:0:0:0:0:1A");
 
+/** Lengths of RPL control messages and options on the wire, in bytes [RFC 6550, 6] */
+#define RPL_HEADER_LENGTH 4                 // ICMPv6 type, code and checksum
+#define RPL_DIS_BASE_LENGTH 2
+#define RPL_DIO_BASE_LENGTH 24
+#define RPL_DAO_BASE_LENGTH 4
+#define RPL_DAO_ACK_BASE_LENGTH 4
+#define RPL_DODAG_ID_LENGTH 16              // optional DODAGID of DAO, DAO-ACK (D flag)
+#define RPL_DODAG_CONFIG_OPTION_LENGTH 16
+#define RPL_PREFIX_INFO_OPTION_LENGTH 32
+#define RPL_TARGET_OPTION_LENGTH 20         // full 128-bit target prefix
+#define RPL_TRANSIT_OPTION_LENGTH 6         // without parent address (storing mode)
+#define RPL_TRANSIT_PARENT_OPTION_LENGTH 22 // with parent address (non-storing mode)
+#define RPL_SRH_LENGTH 64                   // source routing header trailer, not serialized
+
+/** Types of options carried in RPL control messages [RFC 6550, 6.7] */
+enum RPL_CONTROL_OPTION {
+    RPL_CONTROL_OPTION_PAD1 = 0x00,
+    RPL_CONTROL_OPTION_PADN = 0x01,
+    RPL_CONTROL_OPTION_DAG_METRIC_CONTAINER = 0x02,
+    RPL_CONTROL_OPTION_ROUTE_INFO = 0x03,
+    RPL_CONTROL_OPTION_DODAG_CONFIG = 0x04,
+    RPL_CONTROL_OPTION_TARGET = 0x05,
+    RPL_CONTROL_OPTION_TRANSIT = 0x06,
+    RPL_CONTROL_OPTION_PREFIX_INFO = 0x08
+};
+
 enum TRICKLE_EVENTS {
     TRICKLE_START,
     TRICKLE_INTERVAL_UPDATE_EVENT,
     TRICKLE_TRIGGER_EVENT,
 };
 
+/** Reasons for resetting trickle timer to the minimum interval, emitted with 'trickleReset' signal */
+enum TRICKLE_RESET_CAUSE {
+    TRICKLE_RESET_EXTERNAL,         // requested without specifying the cause
+    TRICKLE_RESET_DODAG_JOINED,     // node has joined a DODAG
+    TRICKLE_RESET_PARENT_CHANGED,   // preferred parent has changed [RFC 6550, 8.3]
+    TRICKLE_RESET_DTSN_INCREMENTED, // DTSN incremented to trigger downward route refresh [RFC 6550, 9.6]
+    TRICKLE_RESET_VERSION_CHANGED,  // new DODAG version initiated by the root or learned from a DIO [RFC 6550, 8.2.2.2]
+    TRICKLE_RESET_DIS_RECEIVED,     // multicast DIS received from a neighbor [RFC 6550, 8.3]
+    TRICKLE_RESET_RANK_ERROR,       // repeated rank error in RPL Packet Information, datapath loop [RFC 6550, 11.2.2.2]
+};
+
 enum RPL_SELF_MSG {
     DETACHED_TIMEOUT,
     DAO_ACK_TIMEOUT,
-    RPL_START
+    RPL_START,
+    DAO_COALESCING_TIMEOUT,
+    DTSN_INCREMENT,
+    DAO_REFRESH,
+    GLOBAL_REPAIR,
+    DIS_TIMEOUT
 };
 
 /** Purely for cross-layer SF */
@@ -0,0 +1,201 @@
+/*
+ * Simulation model for RPL (Routing Protocol for Low-Power and Lossy Networks)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *           (C) 2021  Yevhenii Shudrenko
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+
+#include "inet/common/ModuleAccess.h"
+#include "inet/common/Simsignals.h"
+#include "RplDodagVisualizer.h"
+
+namespace inet {
+
+Define_Module(RplDodagVisualizer);
+
+static simsignal_t preferredParentChangedSignal = cComponent::registerSignal("preferredParentChanged");
+static simsignal_t backupParentAddedSignal = cComponent::registerSignal("backupParentAdded");
+static simsignal_t backupParentRemovedSignal = cComponent::registerSignal("backupParentRemoved");
+
+RplDodagVisualizer::RplDodagVisualizer() :
+    arrowheadLength(0),
+    layer(nullptr),
+    changed(false),
+    hasMobileConnectors(false)
+{
+}
+
+void RplDodagVisualizer::initialize(int stage)
+{
+    // without GUI RPL has no listeners and skips preparing the drawing info as well
+    if (stage != INITSTAGE_LOCAL || !hasGUI() || !par("drawConnectors").boolValue())
+        return;
+
+    arrowheadLength = par("arrowheadLength").doubleValue();
+    auto network = getParentModule();
+    layer = new cGroupFigure("rplDodag");
+    network->getCanvas()->addFigure(layer);
+
+    // signals of all nodes propagate up to the network module
+    network->subscribe(preferredParentChangedSignal, this);
+    if (par("showBackupParents").boolValue()) {
+        network->subscribe(backupParentAddedSignal, this);
+        network->subscribe(backupParentRemovedSignal, this);
+    }
+    for (cModule::SubmoduleIterator it(network); !it.end(); ++it) {
+        cModule *node = *it;
+        if (!node->getSubmodule("rpl") || !node->hasPar("numApps"))
+            continue;
+        for (auto i = 0; i < node->par("numApps").intValue(); i++)
+            node->getSubmodule("app", i)->subscribe(packetReceivedSignal, this);
+    }
+}
+
+void RplDodagVisualizer::receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details)
+{
+    Enter_Method_Silent();
+
+    if (signalID == packetReceivedSignal) {
+        numPacketsReceived[getContainingNode(check_and_cast<cModule *>(source))]++;
+        return;
+    }
+
+    auto& node = getNodeConnectors(source);
+    auto dio = check_and_cast_nullable<Dio *>(obj);
+    if (signalID == preferredParentChangedSignal)
+        node.hasPrefParent = dio && setConnector(node.prefParent, dio);
+    else if (signalID == backupParentAddedSignal) {
+        Connector connector;
+        if (setConnector(connector, dio))
+            node.backupParents[dio->getSrcAddress()] = connector;
+    }
+    else if (signalID == backupParentRemovedSignal)
+        node.backupParents.erase(dio->getSrcAddress());
+    changed = true;
+}
+
+void RplDodagVisualizer::refreshDisplay() const
+{
+    if (changed || hasMobileConnectors) {
+        redrawConnectors();
+        changed = false;
+    }
+
+    for (auto const &entry : numPacketsReceived) {
+        auto host = entry.first;
+        if (!host->getSubmodule("rpl")->par("isRoot").boolValue())
+            continue;
+        host->getDisplayString().setTagArg("t", 0, std::string(" num rcvd: " + std::to_string(entry.second)).c_str());
+        host->getDisplayString().setTagArg("t", 1, "l"); // set display text position to 'left'
+    }
+}
+
+RplDodagVisualizer::NodeConnectors& RplDodagVisualizer::getNodeConnectors(cComponent *source)
+{
+    auto host = getContainingNode(check_and_cast<cModule *>(source));
+    auto it = nodes.find(host);
+    if (it != nodes.end())
+        return it->second;
+
+    auto& node = nodes[host];
+    node.mobility = check_and_cast<IMobility *>(host->getSubmodule("mobility"));
+    node.isMobile = node.mobility->getMaxSpeed() > 0;
+    node.hasPrefParent = false;
+    return node;
+}
+
+bool RplDodagVisualizer::setConnector(Connector& connector, const Dio *dio)
+{
+    auto guiTag = dio->findTag<RplGuiTag>();
+    if (!guiTag)
+        return false;
+
+    connector.target = guiTag->getPosition();
+    connector.color = guiTag->getColor();
+    connector.targetMobility = guiTag->isMobile() ? findNodeMobility(guiTag->getNodeName()) : nullptr;
+    return true;
+}
+
+IMobility *RplDodagVisualizer::findNodeMobility(const char *nodeName)
+{
+    auto node = getParentModule()->getModuleByPath((std::string(".") + nodeName).c_str());
+    return node ? dynamic_cast<IMobility *>(node->getSubmodule("mobility")) : nullptr;
+}
+
+void RplDodagVisualizer::redrawConnectors() const
+{
+    hasMobileConnectors = false;
+    for (auto const &entry : paths)
+        entry.second->clearPath();
+
+    for (auto const &entry : nodes) {
+        auto const &node = entry.second;
+        if (node.hasPrefParent)
+            addConnector(node, node.prefParent, false);
+        for (auto const &bp : node.backupParents)
+            addConnector(node, bp.second, true);
+    }
+}
+
+void RplDodagVisualizer::addConnector(const NodeConnectors& node, const Connector& connector, bool dashed) const
+{
+    auto target = connector.targetMobility ? connector.targetMobility->getCurrentPosition() : connector.target;
+    hasMobileConnectors |= node.isMobile || connector.targetMobility;
+    addArrow(getPath(connector.color, dashed), node.mobility->getCurrentPosition(), target);
+}
+
+cPathFigure *RplDodagVisualizer::getPath(const cFigure::Color& color, bool dashed) const
+{
+    uint32_t key = (color.red << 16 | color.green << 8 | color.blue) << 1 | dashed;
+    auto it = paths.find(key);
+    if (it != paths.end())
+        return it->second;
+
+    auto path = new cPathFigure(dashed ? "backupParentConnectors" : "preferredParentConnectors");
+    path->setLineWidth(2);
+    path->setLineColor(color);
+    path->setLineOpacity(dashed ? 0.5 : 1);
+    if (dashed)
+        path->setLineStyle(cFigure::LineStyle::LINE_DASHED);
+    layer->addFigure(path);
+    paths[key] = path;
+    return path;
+}
+
+void RplDodagVisualizer::addArrow(cPathFigure *path, const Coord& from, const Coord& to) const
+{
+    path->addMoveTo(from.x, from.y);
+    path->addLineTo(to.x, to.y);
+
+    auto length = from.distance(to);
+    if (length == 0)
+        return;
+
+    // barbs at 30 degrees to both sides of the line, pointing back to its start
+    auto dx = (from.x - to.x) / length * arrowheadLength;
+    auto dy = (from.y - to.y) / length * arrowheadLength;
+    auto cosine = cos(M_PI / 6);
+    auto sine = sin(M_PI / 6);
+    path->addMoveTo(to.x + dx * cosine - dy * sine, to.y + dx * sine + dy * cosine);
+    path->addLineTo(to.x, to.y);
+    path->addLineTo(to.x + dx * cosine + dy * sine, to.y - dx * sine + dy * cosine);
+}
+
+} // namespace inet
+
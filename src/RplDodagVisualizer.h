@@ -0,0 +1,103 @@
+/*
+ * Simulation model for RPL (Routing Protocol for Low-Power and Lossy Networks)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *           (C) 2021  Yevhenii Shudrenko
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RPLDODAGVISUALIZER_H
+#define _RPLDODAGVISUALIZER_H
+
+#include <map>
+
+#include "inet/common/INETDefs.h"
+#include "inet/mobility/contract/IMobility.h"
+#include "Rpl_m.h"
+
+namespace inet {
+
+/**
+ * Network-wide observer drawing connectors from every node to its preferred and backup parents,
+ * based on positions and colors advertised in DIOs (@see RplGuiTag). Signals only update
+ * the connector list, figures are rebuilt from it at most once per refreshDisplay(),
+ * all connectors of the same color and line style sharing one path figure.
+ * Subscribes to RPL signals only when running with GUI.
+ */
+class RplDodagVisualizer : public cSimpleModule, public cListener
+{
+  protected:
+    /** Connector line to a parent of the node */
+    struct Connector {
+        Coord target; // parent location advertised in DIO
+        cFigure::Color color;
+        IMobility *targetMobility; // parent mobility module, only if it's mobile
+    };
+
+    struct NodeConnectors {
+        IMobility *mobility;
+        bool isMobile;
+        bool hasPrefParent;
+        Connector prefParent;
+        std::map<Ipv6Address, Connector> backupParents;
+    };
+
+  private:
+    std::map<cModule *, NodeConnectors> nodes; // per host module
+    std::map<cModule *, int> numPacketsReceived; // by applications of the node, shown at the roots
+    double arrowheadLength;
+
+    cGroupFigure *layer;
+    mutable std::map<uint32_t, cPathFigure *> paths; // per connector color and line style
+    mutable bool changed; // connectors to be redrawn on the next refresh
+    mutable bool hasMobileConnectors; // connectors to be redrawn on every refresh
+
+  protected:
+    virtual int numInitStages() const override { return NUM_INIT_STAGES; }
+    virtual void initialize(int stage) override;
+    virtual void handleMessage(cMessage *msg) override { throw cRuntimeError("This module doesn't handle messages"); }
+    virtual void refreshDisplay() const override;
+    virtual void receiveSignal(cComponent *source, simsignal_t signalID, cObject *obj, cObject *details) override;
+
+    /** Get connectors of the node containing RPL module @param source, creating the entry if needed */
+    NodeConnectors& getNodeConnectors(cComponent *source);
+
+    /** Set @param connector to the sender of @param dio, return false if it has no GUI info */
+    bool setConnector(Connector& connector, const Dio *dio);
+
+    /** Look up mobility module of the node named @param nodeName */
+    IMobility *findNodeMobility(const char *nodeName);
+
+    /** Rebuild path figures from the connector list */
+    void redrawConnectors() const;
+
+    /** Path figure holding connectors of @param color and line style, created on first use */
+    cPathFigure *getPath(const cFigure::Color& color, bool dashed) const;
+
+    /** Append @param connector of @param node to the path figure of its color and line style */
+    void addConnector(const NodeConnectors& node, const Connector& connector, bool dashed) const;
+
+    /** Append line from @param from to @param to with a barbed arrowhead to @param path */
+    void addArrow(cPathFigure *path, const Coord& from, const Coord& to) const;
+
+  public:
+    RplDodagVisualizer();
+};
+
+} // namespace inet
+
+#endif
+
@@ -0,0 +1,69 @@
+/*
+ * Simulation model for RPL (Routing Protocol for Low-Power and Lossy Networks)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *           (C) 2021  Yevhenii Shudrenko
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "RplInstance.h"
+
+namespace inet {
+
+RplInstance::RplInstance(uint8_t instanceId, ObjectiveFunction *objectiveFunction, TrickleTimer *trickleTimer, bool primary) :
+    instanceId(instanceId),
+    dodagId(Ipv6Address::UNSPECIFIED_ADDRESS),
+    dodagVersion(DEFAULT_INIT_DODAG_VERSION),
+    dtsn(0),
+    pathSequence(0),
+    rank(INF_RANK),
+    storing(true),
+    multicast(false),
+    preferredParent(nullptr),
+    failoverParent(nullptr),
+    objectiveFunction(objectiveFunction),
+    trickleTimer(trickleTimer),
+    versionChangedAt(-1),
+    primary(primary)
+{}
+
+RplInstance::~RplInstance()
+{
+    delete objectiveFunction;
+}
+
+Ipv6Address RplInstance::getNextHop(const Ipv6Address &dest) const
+{
+    auto route = downwardRoutes.find(dest);
+    if (route != downwardRoutes.end())
+        return route->second;
+
+    // everything else travels upwards to the DODAG root
+    return preferredParent ? preferredParent->getSrcAddress() : Ipv6Address::UNSPECIFIED_ADDRESS;
+}
+
+std::string RplInstance::str() const
+{
+    std::ostringstream out;
+    out << "instance " << (int) instanceId << (primary ? " (primary)" : "")
+        << ", dodagId = " << dodagId << ", version = " << (int) dodagVersion
+        << ", rank = " << rank << ", pref. parent = "
+        << (preferredParent ? preferredParent->getSrcAddress().str() : std::string("-"))
+        << ", " << downwardRoutes.size() << " downward routes";
+    return out.str();
+}
+
+} // namespace inet
@@ -0,0 +1,98 @@
+/*
+ * Simulation model for RPL (Routing Protocol for Low-Power and Lossy Networks)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *           (C) 2021  Yevhenii Shudrenko
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RPLINSTANCE_H
+#define _RPLINSTANCE_H
+
+#include <map>
+
+#include "inet/common/INETDefs.h"
+#include "inet/networklayer/contract/ipv6/Ipv6Address.h"
+#include "ObjectiveFunction.h"
+#include "TrickleTimer.h"
+#include "Rpl_m.h"
+#include "RplDefs.h"
+
+namespace inet {
+
+/**
+ * State of a single RPL instance the node participates in [RFC 6550, 3.1.2].
+ * Each instance maintains its own DODAG membership, parent sets, rank,
+ * objective function and trickle timer, so that a node may serve several
+ * traffic classes with different optimization objectives simultaneously.
+ */
+class RplInstance : public cObject
+{
+  public:
+    uint8_t instanceId;
+    Ipv6Address dodagId;
+    uint8_t dodagVersion;
+    uint8_t dtsn;
+    uint8_t pathSequence; // Transit path sequence of own targets, incremented on every parent change
+    uint16_t rank;
+    bool storing;
+    bool multicast; // storing mode with multicast support (MOP 3)
+    Dio *preferredParent;
+    Dio *failoverParent; // precomputed feasible successor taking over immediately if preferred parent fails
+    std::map<Ipv6Address, Dio *> candidateParents;
+    std::map<Ipv6Address, Dio *> backupParents;
+    ObjectiveFunction *objectiveFunction;
+    TrickleTimer *trickleTimer;
+    simtime_t versionChangedAt; // time of switching to the current DODAG version, -1 once a parent in it is selected
+
+    /**
+     * Downward routes learned from DAOs of a secondary instance (destination -> next hop).
+     * Only the primary instance populates the IPv6 routing table, traffic of secondary
+     * ones is steered hop-by-hop using these routes and the preferred parent.
+     */
+    std::map<Ipv6Address, Ipv6Address> downwardRoutes;
+    std::map<Ipv6Address, uint8_t> downwardPathSequences; // Transit path sequence of the above routes
+
+    /**
+     * DIO last advertised on each RPL interface (interface id -> DIO), shared as immutable chunk
+     * by the subsequent broadcasts until the advertised state changes, @see Rpl::getDio()
+     */
+    std::map<int, Ptr<const Dio>> dioCache;
+
+  private:
+    bool primary;
+
+  public:
+    RplInstance(uint8_t instanceId, ObjectiveFunction *objectiveFunction, TrickleTimer *trickleTimer, bool primary);
+    virtual ~RplInstance();
+
+    /** @return true if the instance owns the IPv6 routing table of the node */
+    bool isPrimary() const { return primary; }
+
+    /** @return next hop towards @param dest for traffic of this instance, unspecified if unknown */
+    Ipv6Address getNextHop(const Ipv6Address &dest) const;
+
+    virtual std::string str() const override;
+};
+
+inline std::ostream& operator<<(std::ostream& os, const RplInstance& rplInstance)
+{
+    return os << rplInstance.str();
+}
+
+} // namespace inet
+
+#endif
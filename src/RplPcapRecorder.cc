@@ -0,0 +1,161 @@
+/*
+ * Simulation model for RPL (Routing Protocol for Low-Power and Lossy Networks)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *           (C) 2021  Yevhenii Shudrenko
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "Rpl.h"
+#include "RplPcapRecorder.h"
+
+namespace inet {
+
+Define_Module(RplPcapRecorder);
+
+static void appendUint32Be(std::vector<uint8_t>& bytes, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+        bytes.push_back(value >> shift);
+}
+
+/** Sum of 16-bit big-endian words, odd length padded with zero [RFC 1071] */
+static uint32_t sumWords(const uint8_t *data, size_t length)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < length; i += 2)
+        sum += data[i] << 8 | (i + 1 < length ? data[i + 1] : 0);
+    return sum;
+}
+
+RplPcapRecorder::RplPcapRecorder() :
+    networkProtocol(nullptr),
+    pcapngFile(nullptr),
+    interfaceId(0),
+    snaplen(0),
+    recordData(true),
+    numRecorded(0),
+    numSkipped(0),
+    numSizeLimitDrops(0)
+{
+}
+
+RplPcapRecorder::~RplPcapRecorder()
+{
+    if (pcapngFile)
+        pcapngFile->close();
+}
+
+void RplPcapRecorder::initialize(int stage)
+{
+    if (stage == INITSTAGE_LOCAL) {
+        WATCH(numRecorded);
+        WATCH(numSkipped);
+        WATCH(numSizeLimitDrops);
+    }
+    else if (stage == INITSTAGE_ROUTING_PROTOCOLS) {
+        std::string pcapFile = par("pcapFile").stdstringValue();
+        auto node = getContainingNode(this);
+        cPatternMatcher nodeFilter(par("nodeFilter").stringValue(), true, true, true);
+        if (pcapFile.empty() || !nodeFilter.matches(node->getFullName()))
+            return;
+
+        snaplen = par("snaplen").intValue();
+        recordData = par("recordData").boolValue();
+        pcapngFile = PcapngFile::open(pcapFile, par("maxFileSize").intValue(), par("alwaysFlush").boolValue());
+        interfaceId = pcapngFile->addInterface(node->getFullName(), snaplen);
+
+        // register ahead of RPL to capture datagrams before they are dropped or modified on reception
+        networkProtocol = getModuleFromPar<INetfilter>(par("networkProtocolModule"), this);
+        networkProtocol->registerHook(-1, this);
+    }
+}
+
+void RplPcapRecorder::finish()
+{
+    if (!pcapngFile)
+        return;
+    recordScalar("pcapRecorded", numRecorded);
+    recordScalar("pcapSkipped", numSkipped);
+    recordScalar("pcapSizeLimitDropped", numSizeLimitDrops);
+    pcapngFile->close();
+    pcapngFile = nullptr;
+}
+
+void RplPcapRecorder::recordDatagram(Packet *datagram, bool outbound)
+{
+    auto copy = datagram->dup();
+    auto ipv6Header = removeNetworkProtocolHeader<Ipv6Header>(copy);
+    // RPL control messages are dispatched as MANET protocol within the model, on the wire they are ICMPv6
+    bool isRplPacket = ipv6Header->getProtocolId() == IP_PROT_MANET;
+    if (!isRplPacket && !recordData) {
+        delete copy;
+        return;
+    }
+    if (isRplPacket)
+        ipv6Header->setProtocolId(IP_PROT_IPv6_ICMP);
+    Ptr<const Ipv6Header> header = ipv6Header;
+    insertNetworkProtocolHeader(copy, Protocol::ipv6, ipv6Header);
+    // source routing header is appended as trailer in the model and has no wire representation
+    if (Rpl::hasTrailingChunk<SourceRoutingHeader>(copy, B(RPL_SRH_LENGTH)))
+        copy->popAtBack<SourceRoutingHeader>(B(RPL_SRH_LENGTH));
+
+    try {
+        auto bytes = copy->peekAllAsBytes()->getBytes();
+        if (isRplPacket)
+            setIcmpv6Checksum(bytes, header.get());
+        uint32_t originalLength = bytes.size();
+        if (bytes.size() > snaplen)
+            bytes.resize(snaplen);
+        if (pcapngFile->writePacket(interfaceId, simTime().inUnit(SIMTIME_NS), bytes, originalLength, outbound))
+            numRecorded++;
+        else
+            numSizeLimitDrops++;
+    }
+    catch (cRuntimeError& e) {
+        EV_WARN << "Cannot serialize " << copy << " for capture: " << e.what() << endl;
+        numSkipped++;
+    }
+    delete copy;
+}
+
+void RplPcapRecorder::setIcmpv6Checksum(std::vector<uint8_t>& bytes, const Ipv6Header *ipv6Header)
+{
+    // ICMPv6 message follows the IPv6 header including its extension headers
+    size_t start = B(ipv6Header->getChunkLength()).get();
+    if (bytes.size() < start + RPL_HEADER_LENGTH)
+        return;
+    uint32_t upperLayerLength = bytes.size() - start;
+
+    // pseudo-header: addresses, upper-layer packet length and next header [RFC 8200, 8.1]
+    std::vector<uint8_t> pseudoHeader;
+    for (auto address : { ipv6Header->getSrcAddress(), ipv6Header->getDestAddress() })
+        for (int i = 0; i < 4; i++)
+            appendUint32Be(pseudoHeader, address.words()[i]);
+    appendUint32Be(pseudoHeader, upperLayerLength);
+    appendUint32Be(pseudoHeader, IP_PROT_IPv6_ICMP);
+
+    bytes[start + 2] = bytes[start + 3] = 0;
+    uint32_t sum = sumWords(pseudoHeader.data(), pseudoHeader.size()) + sumWords(bytes.data() + start, upperLayerLength);
+    while (sum >> 16)
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    uint16_t checksum = ~sum;
+    bytes[start + 2] = checksum >> 8;
+    bytes[start + 3] = checksum & 0xFF;
+}
+
+} // namespace inet
+
@@ -0,0 +1,90 @@
+/*
+ * Simulation model for RPL (Routing Protocol for Low-Power and Lossy Networks)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *           (C) 2021  Yevhenii Shudrenko
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RPLPCAPRECORDER_H
+#define _RPLPCAPRECORDER_H
+
+#include "inet/common/INETDefs.h"
+#include "inet/networklayer/contract/INetfilter.h"
+#include "inet/networklayer/ipv6/Ipv6Header.h"
+#include "PcapngFile.h"
+
+namespace inet {
+
+/**
+ * Records IPv6 datagrams sent and received by the node into a PCAPNG file shared by the whole network.
+ * RPL control messages are exported as ICMPv6 type 155, so that captures can be inspected
+ * with Wireshark side by side with real deployments.
+ */
+class RplPcapRecorder : public cSimpleModule, public NetfilterBase::HookBase
+{
+  private:
+    INetfilter *networkProtocol;
+    PcapngFile *pcapngFile;
+    uint32_t interfaceId;
+    uint32_t snaplen;
+    bool recordData;
+
+    /** Statistics */
+    int numRecorded;
+    int numSkipped; // datagrams containing chunks without serializer
+    int numSizeLimitDrops; // datagrams not written due to the file size limit
+
+  protected:
+    virtual int numInitStages() const override { return NUM_INIT_STAGES; }
+    virtual void initialize(int stage) override;
+    virtual void finish() override;
+    virtual void handleMessage(cMessage *msg) override { throw cRuntimeError("This module doesn't handle messages"); }
+
+    /**
+     * Serialize a copy of the datagram and write it to the capture file
+     *
+     * @param datagram IPv6 datagram with the network header at front
+     * @param outbound packet direction
+     */
+    void recordDatagram(Packet *datagram, bool outbound);
+
+    /**
+     * Fill in ICMPv6 checksum of the RPL message, which the model leaves zero [RFC 4443, 2.3]
+     *
+     * @param bytes serialized datagram
+     * @param ipv6Header network header of the datagram, provides the pseudo-header
+     */
+    static void setIcmpv6Checksum(std::vector<uint8_t>& bytes, const Ipv6Header *ipv6Header);
+
+  public:
+    RplPcapRecorder();
+    ~RplPcapRecorder();
+
+    /** Netfilter hooks */
+    // datagram received from the link, before RPL processes it
+    virtual Result datagramPreRoutingHook(Packet *datagram) override { Enter_Method_Silent(); recordDatagram(datagram, false); return ACCEPT; }
+    virtual Result datagramForwardHook(Packet *datagram) override { return ACCEPT; }
+    // datagram handed to the link, either originated or forwarded
+    virtual Result datagramPostRoutingHook(Packet *datagram) override { Enter_Method_Silent(); recordDatagram(datagram, true); return ACCEPT; }
+    virtual Result datagramLocalInHook(Packet *datagram) override { return ACCEPT; }
+    virtual Result datagramLocalOutHook(Packet *datagram) override { return ACCEPT; }
+};
+
+} // namespace inet
+
+#endif
+
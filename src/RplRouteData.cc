@@ -26,6 +26,7 @@ namespace inet {
 
 RplRouteData::RplRouteData() {
     dtsn = 0;
+    pathSequence = 0;
     expirationTime = 0;
     dodagId = Ipv6Address::UNSPECIFIED_ADDRESS;
     instanceId = 0;
@@ -40,6 +41,7 @@ std::string RplRouteData::str() const
     std::ostringstream out;
     out << "dodagId/RplInstance = " << getDodagId() << " - " << getInstanceId()
         << ", \n sequenceNumber = " << getDtsn()
+        << ", \n pathSequence = " << (int) getPathSequence()
         << ", \n expirationTime = " << getExpirationTime();
     return out.str();
 };
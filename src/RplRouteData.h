@@ -33,6 +33,7 @@ private:
     Ipv6Address dodagId;
     uint8_t instanceId;
     uint8_t dtsn;
+    uint8_t pathSequence;
     simtime_t expirationTime;
 
 public:
@@ -45,6 +46,9 @@ public:
     uint8_t getDtsn() const { return dtsn; }
     void setDtsn(uint8_t dtsn) { this->dtsn = dtsn; }
 
+    uint8_t getPathSequence() const { return pathSequence; }
+    void setPathSequence(uint8_t pathSequence) { this->pathSequence = pathSequence; }
+
     simtime_t getExpirationTime() const { return expirationTime; }
     void setExpirationTime(simtime_t expirationTime) { this->expirationTime = expirationTime; }
 
@@ -0,0 +1,380 @@
+/*
+ * Simulation model for RPL (Routing Protocol for Low-Power and Lossy Networks)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *           (C) 2021  Yevhenii Shudrenko
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <vector>
+
+#include "inet/common/packet/serializer/ChunkSerializerRegistry.h"
+#include "RplSerializer.h"
+#include "Rpl_m.h"
+
+namespace inet {
+
+Register_Serializer(RplHeader, RplHeaderSerializer);
+Register_Serializer(Dio, DioSerializer);
+Register_Serializer(Dao, DaoSerializer);
+Register_Serializer(DaoAck, DaoAckSerializer);
+Register_Serializer(Dis, DisSerializer);
+Register_Serializer(RplTargetInfo, RplTargetInfoSerializer);
+Register_Serializer(RplTransitInfo, RplTransitInfoSerializer);
+
+#define DIO_GROUNDED_FLAG 0x80
+#define DIO_MOP_SHIFT 3
+#define DIO_MOP_MASK 0x07
+#define DAO_ACK_REQUIRED_FLAG 0x80 // K flag
+#define DAO_DODAG_ID_FLAG 0x40 // D flag
+#define PIO_ROUTER_ADDRESS_FLAG 0x20 // R flag, prefix field carries complete router address
+#define INFINITE_LIFETIME 0xFFFFFFFF
+
+static void skipOption(MemoryInputStream& stream, uint8_t length)
+{
+    for (int i = 0; i < length; i++)
+        stream.readByte();
+}
+
+/** Options allowed in DIO [RFC 6550, 6.3.3] */
+static bool isDioOption(uint8_t type)
+{
+    return type == RPL_CONTROL_OPTION_PADN || type == RPL_CONTROL_OPTION_DAG_METRIC_CONTAINER
+            || type == RPL_CONTROL_OPTION_ROUTE_INFO || type == RPL_CONTROL_OPTION_DODAG_CONFIG
+            || type == RPL_CONTROL_OPTION_PREFIX_INFO;
+}
+
+static void serializeTargetOption(MemoryOutputStream& stream, const Ipv6Address& target)
+{
+    stream.writeByte(RPL_CONTROL_OPTION_TARGET);
+    stream.writeByte(RPL_TARGET_OPTION_LENGTH - 2);
+    stream.writeByte(0); // flags
+    stream.writeByte(128); // prefix length
+    stream.writeIpv6Address(target);
+}
+
+//
+// RPL header
+//
+
+void RplHeaderSerializer::serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const
+{
+    const auto& rplHeader = staticPtrCast<const RplHeader>(chunk);
+    stream.writeByte(rplHeader->getIcmpv6Type());
+    stream.writeByte(rplHeader->getIcmpv6Code());
+    stream.writeUint16Be(rplHeader->getChksum());
+}
+
+const Ptr<Chunk> RplHeaderSerializer::deserialize(MemoryInputStream& stream) const
+{
+    auto rplHeader = makeShared<RplHeader>();
+    if (stream.readByte() != rplHeader->getIcmpv6Type())
+        rplHeader->markIncorrect();
+    rplHeader->setIcmpv6Code((RplPacketCode) stream.readByte());
+    rplHeader->setChksum(stream.readUint16Be());
+    return rplHeader;
+}
+
+//
+// DIO
+//
+
+void DioSerializer::serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const
+{
+    const auto& dio = staticPtrCast<const Dio>(chunk);
+    stream.writeByte(dio->getInstanceId());
+    stream.writeByte(dio->getDodagVersion());
+    stream.writeUint16Be(dio->getRank());
+    stream.writeByte((dio->getGrounded() ? DIO_GROUNDED_FLAG : 0) | (dio->getMop() & DIO_MOP_MASK) << DIO_MOP_SHIFT);
+    stream.writeByte(dio->getDtsn());
+    stream.writeByte(0); // flags
+    stream.writeByte(0); // reserved
+    stream.writeIpv6Address(dio->getDodagId());
+
+    // DODAG Configuration option
+    stream.writeByte(RPL_CONTROL_OPTION_DODAG_CONFIG);
+    stream.writeByte(RPL_DODAG_CONFIG_OPTION_LENGTH - 2);
+    stream.writeByte(0); // flags, A and PCS
+    stream.writeByte(dio->getDioNumDoublings());
+    stream.writeByte(dio->getMinInterval());
+    stream.writeByte(dio->getDioRedundancyConst());
+    stream.writeUint16Be(0); // MaxRankIncrease, local repair disabled
+    stream.writeUint16Be(dio->getMinHopRankIncrease());
+    stream.writeUint16Be(dio->getOcp());
+    stream.writeByte(0); // reserved
+    stream.writeByte(INFINITE_PATH_LIFETIME); // default lifetime
+    stream.writeUint16Be(0xFFFF); // lifetime unit
+
+    // Prefix Information option, advertises sender address
+    stream.writeByte(RPL_CONTROL_OPTION_PREFIX_INFO);
+    stream.writeByte(RPL_PREFIX_INFO_OPTION_LENGTH - 2);
+    stream.writeByte(128); // prefix length
+    stream.writeByte(PIO_ROUTER_ADDRESS_FLAG);
+    stream.writeUint32Be(INFINITE_LIFETIME); // valid lifetime
+    stream.writeUint32Be(INFINITE_LIFETIME); // preferred lifetime
+    stream.writeUint32Be(0); // reserved
+    stream.writeIpv6Address(dio->getSrcAddress());
+}
+
+const Ptr<Chunk> DioSerializer::deserialize(MemoryInputStream& stream) const
+{
+    auto dio = makeShared<Dio>();
+    dio->setInstanceId(stream.readByte());
+    dio->setDodagVersion(stream.readByte());
+    dio->setRank(stream.readUint16Be());
+    uint8_t flags = stream.readByte();
+    dio->setGrounded(flags & DIO_GROUNDED_FLAG);
+    dio->setMop((flags >> DIO_MOP_SHIFT) & DIO_MOP_MASK);
+    dio->setStoring(dio->getMop() == MOP_STORING_NO_MULTICAST || dio->getMop() == MOP_STORING_MULTICAST);
+    dio->setDtsn(stream.readByte());
+    stream.readByte(); // flags
+    stream.readByte(); // reserved
+    dio->setDodagId(stream.readIpv6Address());
+
+    // options not allowed in DIO belong to the data following it
+    while (stream.getRemainingLength() > B(0)) {
+        auto optionStart = stream.getPosition();
+        uint8_t type = stream.readByte();
+        if (type == RPL_CONTROL_OPTION_PAD1)
+            continue;
+        if (!isDioOption(type)) {
+            stream.seek(optionStart);
+            break;
+        }
+        uint8_t length = stream.readByte();
+        switch (type) {
+            case RPL_CONTROL_OPTION_DODAG_CONFIG: {
+                stream.readByte(); // flags
+                dio->setDioNumDoublings(stream.readByte());
+                dio->setMinInterval(stream.readByte());
+                dio->setDioRedundancyConst(stream.readByte());
+                stream.readUint16Be(); // MaxRankIncrease
+                dio->setMinHopRankIncrease(stream.readUint16Be());
+                dio->setOcp((Ocp) stream.readUint16Be());
+                skipOption(stream, length - 10); // reserved, lifetimes
+                break;
+            }
+            case RPL_CONTROL_OPTION_PREFIX_INFO: {
+                stream.readByte(); // prefix length
+                bool routerAddress = stream.readByte() & PIO_ROUTER_ADDRESS_FLAG;
+                skipOption(stream, 12); // lifetimes, reserved
+                auto prefix = stream.readIpv6Address();
+                if (routerAddress)
+                    dio->setSrcAddress(prefix);
+                skipOption(stream, length - 30);
+                break;
+            }
+            default:
+                skipOption(stream, length);
+        }
+    }
+    return dio;
+}
+
+//
+// DAO
+//
+
+void DaoSerializer::serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const
+{
+    const auto& dao = staticPtrCast<const Dao>(chunk);
+    bool dodagIdPresent = !dao->getDodagId().isUnspecified();
+    stream.writeByte(dao->getInstanceId());
+    stream.writeByte((dao->getDaoAckRequired() ? DAO_ACK_REQUIRED_FLAG : 0) | (dodagIdPresent ? DAO_DODAG_ID_FLAG : 0));
+    stream.writeByte(0); // reserved
+    stream.writeByte(dao->getSeqNum());
+    if (dodagIdPresent)
+        stream.writeIpv6Address(dao->getDodagId());
+
+    // in non-storing mode options are serialized by the appended RplTargetInfo, RplTransitInfo chunks
+    if (dao->getTransitOptionsAppended())
+        return;
+
+    serializeTargetOption(stream, dao->getReachableDest());
+    for (size_t i = 0; i < dao->getKnownTargetsArraySize(); i++)
+        serializeTargetOption(stream, dao->getKnownTargets(i));
+
+    // Transit Information option, parent address is omitted in storing mode
+    stream.writeByte(RPL_CONTROL_OPTION_TRANSIT);
+    stream.writeByte(RPL_TRANSIT_OPTION_LENGTH - 2);
+    stream.writeByte(0); // flags, E
+    stream.writeByte(0); // path control
+    stream.writeByte(dao->getPathSequence());
+    stream.writeByte(dao->getPathLifetime());
+}
+
+const Ptr<Chunk> DaoSerializer::deserialize(MemoryInputStream& stream) const
+{
+    auto dao = makeShared<Dao>();
+    dao->setInstanceId(stream.readByte());
+    uint8_t flags = stream.readByte();
+    dao->setDaoAckRequired(flags & DAO_ACK_REQUIRED_FLAG);
+    stream.readByte(); // reserved
+    dao->setSeqNum(stream.readByte());
+    if (flags & DAO_DODAG_ID_FLAG)
+        dao->setDodagId(stream.readIpv6Address());
+
+    /**
+     * Options end with the Transit option. Target followed by Transit with parent address
+     * (non-storing mode) is left to be deserialized as RplTargetInfo, RplTransitInfo chunks
+     */
+    std::vector<Ipv6Address> targets;
+    b lastTargetStart = b(-1);
+    while (stream.getRemainingLength() > B(0)) {
+        auto optionStart = stream.getPosition();
+        uint8_t type = stream.readByte();
+        if (type == RPL_CONTROL_OPTION_PAD1)
+            continue;
+        if (type != RPL_CONTROL_OPTION_PADN && type != RPL_CONTROL_OPTION_TARGET && type != RPL_CONTROL_OPTION_TRANSIT) {
+            stream.seek(optionStart);
+            break;
+        }
+        uint8_t length = stream.readByte();
+        if (type == RPL_CONTROL_OPTION_TARGET) {
+            stream.readByte(); // flags
+            stream.readByte(); // prefix length
+            targets.push_back(stream.readIpv6Address());
+            skipOption(stream, length - 18);
+            lastTargetStart = optionStart;
+        }
+        else if (type == RPL_CONTROL_OPTION_TRANSIT && length == RPL_TRANSIT_PARENT_OPTION_LENGTH - 2 && lastTargetStart >= b(0)) {
+            stream.seek(lastTargetStart);
+            dao->setTransitOptionsAppended(true);
+            // appended Target is not among DAO's own options, but stands for its reachable destination if there's no other
+            if (targets.size() > 1)
+                targets.pop_back();
+            break;
+        }
+        else if (type == RPL_CONTROL_OPTION_TRANSIT) {
+            stream.readByte(); // flags
+            stream.readByte(); // path control
+            dao->setPathSequence(stream.readByte());
+            dao->setPathLifetime(stream.readByte());
+            skipOption(stream, length - 4);
+            break;
+        }
+        else
+            skipOption(stream, length);
+    }
+
+    if (targets.empty()) {
+        dao->markIncorrect();
+        return dao;
+    }
+    dao->setReachableDest(targets.front());
+    dao->setKnownTargetsArraySize(targets.size() - 1);
+    for (size_t i = 1; i < targets.size(); i++)
+        dao->setKnownTargets(i - 1, targets[i]);
+    return dao;
+}
+
+//
+// DAO-ACK
+//
+
+void DaoAckSerializer::serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const
+{
+    const auto& daoAck = staticPtrCast<const DaoAck>(chunk);
+    bool dodagIdPresent = !daoAck->getDodagId().isUnspecified();
+    stream.writeByte(daoAck->getInstanceId());
+    stream.writeByte(dodagIdPresent ? DAO_DODAG_ID_FLAG : 0);
+    stream.writeByte(daoAck->getSeqNum());
+    stream.writeByte(daoAck->getCongestionHint()); // status, below 128 is acceptance
+    if (dodagIdPresent)
+        stream.writeIpv6Address(daoAck->getDodagId());
+}
+
+const Ptr<Chunk> DaoAckSerializer::deserialize(MemoryInputStream& stream) const
+{
+    auto daoAck = makeShared<DaoAck>();
+    daoAck->setInstanceId(stream.readByte());
+    bool dodagIdPresent = stream.readByte() & DAO_DODAG_ID_FLAG;
+    daoAck->setSeqNum(stream.readByte());
+    daoAck->setCongestionHint(stream.readByte());
+    if (dodagIdPresent)
+        daoAck->setDodagId(stream.readIpv6Address());
+    return daoAck;
+}
+
+//
+// DIS
+//
+
+void DisSerializer::serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const
+{
+    stream.writeByte(0); // flags
+    stream.writeByte(0); // reserved
+}
+
+const Ptr<Chunk> DisSerializer::deserialize(MemoryInputStream& stream) const
+{
+    auto dis = makeShared<Dis>();
+    stream.readByte(); // flags
+    stream.readByte(); // reserved
+    // Solicited Information and padding options are not interpreted
+    while (stream.getRemainingLength() > B(0)) {
+        if (stream.readByte() != RPL_CONTROL_OPTION_PAD1)
+            skipOption(stream, stream.readByte());
+    }
+    return dis;
+}
+
+//
+// Non-storing mode Target, Transit Information options
+//
+
+void RplTargetInfoSerializer::serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const
+{
+    serializeTargetOption(stream, staticPtrCast<const RplTargetInfo>(chunk)->getTarget());
+}
+
+const Ptr<Chunk> RplTargetInfoSerializer::deserialize(MemoryInputStream& stream) const
+{
+    auto targetInfo = makeShared<RplTargetInfo>();
+    if (stream.readByte() != RPL_CONTROL_OPTION_TARGET || stream.readByte() != RPL_TARGET_OPTION_LENGTH - 2)
+        targetInfo->markIncorrect();
+    stream.readByte(); // flags
+    stream.readByte(); // prefix length
+    targetInfo->setTarget(stream.readIpv6Address());
+    return targetInfo;
+}
+
+void RplTransitInfoSerializer::serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const
+{
+    stream.writeByte(RPL_CONTROL_OPTION_TRANSIT);
+    stream.writeByte(RPL_TRANSIT_PARENT_OPTION_LENGTH - 2);
+    stream.writeByte(0); // flags, E
+    stream.writeByte(0); // path control
+    stream.writeByte(0); // path sequence
+    stream.writeByte(INFINITE_PATH_LIFETIME);
+    stream.writeIpv6Address(staticPtrCast<const RplTransitInfo>(chunk)->getTransit());
+}
+
+const Ptr<Chunk> RplTransitInfoSerializer::deserialize(MemoryInputStream& stream) const
+{
+    auto transitInfo = makeShared<RplTransitInfo>();
+    if (stream.readByte() != RPL_CONTROL_OPTION_TRANSIT || stream.readByte() != RPL_TRANSIT_PARENT_OPTION_LENGTH - 2)
+        transitInfo->markIncorrect();
+    stream.readByte(); // flags
+    stream.readByte(); // path control
+    stream.readByte(); // path sequence
+    stream.readByte(); // path lifetime
+    transitInfo->setTransit(stream.readIpv6Address());
+    return transitInfo;
+}
+
+} // namespace inet
+
@@ -0,0 +1,126 @@
+/*
+ * Simulation model for RPL (Routing Protocol for Low-Power and Lossy Networks)
+ *
+ * Copyright (C) 2021  Institute of Communication Networks (ComNets),
+ *                     Hamburg University of Technology (TUHH)
+ *           (C) 2021  Yevhenii Shudrenko
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RPLSERIALIZER_H
+#define _RPLSERIALIZER_H
+
+#include "inet/common/packet/serializer/FieldsChunkSerializer.h"
+
+namespace inet {
+
+/**
+ * Converts between RPL control message header (ICMPv6 type 155) and its binary representation
+ */
+class RplHeaderSerializer : public FieldsChunkSerializer
+{
+  protected:
+    virtual void serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const override;
+    virtual const Ptr<Chunk> deserialize(MemoryInputStream& stream) const override;
+
+  public:
+    RplHeaderSerializer() : FieldsChunkSerializer() {}
+};
+
+/**
+ * Converts between DIO and its binary representation [RFC 6550, 6.3.1],
+ * followed by DODAG Configuration [6.7.6] and Prefix Information [6.7.10] options
+ */
+class DioSerializer : public FieldsChunkSerializer
+{
+  protected:
+    virtual void serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const override;
+    virtual const Ptr<Chunk> deserialize(MemoryInputStream& stream) const override;
+
+  public:
+    DioSerializer() : FieldsChunkSerializer() {}
+};
+
+/**
+ * Converts between DAO and its binary representation [RFC 6550, 6.4.1],
+ * followed by RPL Target [6.7.7] option per advertised destination and a Transit Information option [6.7.8]
+ */
+class DaoSerializer : public FieldsChunkSerializer
+{
+  protected:
+    virtual void serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const override;
+    virtual const Ptr<Chunk> deserialize(MemoryInputStream& stream) const override;
+
+  public:
+    DaoSerializer() : FieldsChunkSerializer() {}
+};
+
+/**
+ * Converts between DAO-ACK and its binary representation [RFC 6550, 6.5.1]
+ */
+class DaoAckSerializer : public FieldsChunkSerializer
+{
+  protected:
+    virtual void serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const override;
+    virtual const Ptr<Chunk> deserialize(MemoryInputStream& stream) const override;
+
+  public:
+    DaoAckSerializer() : FieldsChunkSerializer() {}
+};
+
+/**
+ * Converts between DIS and its binary representation [RFC 6550, 6.2.1]
+ */
+class DisSerializer : public FieldsChunkSerializer
+{
+  protected:
+    virtual void serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const override;
+    virtual const Ptr<Chunk> deserialize(MemoryInputStream& stream) const override;
+
+  public:
+    DisSerializer() : FieldsChunkSerializer() {}
+};
+
+/**
+ * Converts between trailing RPL Target option of non-storing mode DAO and its binary representation
+ */
+class RplTargetInfoSerializer : public FieldsChunkSerializer
+{
+  protected:
+    virtual void serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const override;
+    virtual const Ptr<Chunk> deserialize(MemoryInputStream& stream) const override;
+
+  public:
+    RplTargetInfoSerializer() : FieldsChunkSerializer() {}
+};
+
+/**
+ * Converts between trailing Transit Information option of non-storing mode DAO, including
+ * the parent address, and its binary representation
+ */
+class RplTransitInfoSerializer : public FieldsChunkSerializer
+{
+  protected:
+    virtual void serialize(MemoryOutputStream& stream, const Ptr<const Chunk>& chunk) const override;
+    virtual const Ptr<Chunk> deserialize(MemoryInputStream& stream) const override;
+
+  public:
+    RplTransitInfoSerializer() : FieldsChunkSerializer() {}
+};
+
+} // namespace inet
+
+#endif
+
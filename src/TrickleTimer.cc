@@ -34,7 +34,10 @@ TrickleTimer::TrickleTimer() :
     numDoublings(DEFAULT_DIO_INTERVAL_DOUBLINGS),
     redundancyConst(DEFAULT_DIO_REDUNDANCY_CONST),
     started(false),
-    ctrlMsgReceivedCtn(0)
+    ctrlMsgReceivedCtn(0),
+    numTransmissions(0),
+    numSuppressions(0),
+    intervalStartedAt(-1)
 {
 }
 
@@ -46,9 +49,35 @@ void TrickleTimer::initialize(int stage) {
     if (stage == INITSTAGE_LOCAL) {
         intervalExponent = par("intervalExponent").intValue();
         pStartIntervalOverride = par("startIntervalOverride").intValue();
+
+        transmissionSignal = registerSignal("trickleTransmission");
+        suppressionSignal = registerSignal("trickleSuppression");
+        resetSignal = registerSignal("trickleReset");
+        intervalSignal = registerSignal("trickleInterval");
+
+        WATCH(numTransmissions);
+        WATCH(numSuppressions);
+        WATCH_MAP(timeAtInterval);
     }
 }
 
+void TrickleTimer::finish() {
+    updateIntervalStats();
+
+    auto numTriggers = numTransmissions + numSuppressions;
+    recordScalar("suppressionRatio", numTriggers > 0 ? (double) numSuppressions / numTriggers : 0);
+
+    for (auto const &entry : timeAtInterval)
+        recordScalar(std::string("timeAtInterval:" + std::to_string(entry.first) + "s").c_str(), entry.second);
+}
+
+void TrickleTimer::updateIntervalStats() {
+    if (intervalStartedAt >= 0)
+        timeAtInterval[currentInterval] += simTime() - intervalStartedAt;
+
+    intervalStartedAt = started ? simTime() : -1;
+}
+
 void TrickleTimer::stop() {
     try {
         cancelAndDelete(trickleTriggerEvent);
@@ -77,6 +106,8 @@ void TrickleTimer::start(bool warmupDelay, int skipIntervalDoublings) {
         maxInterval = std::numeric_limits<int>::max();
 
     ctrlMsgReceivedCtn = 0;
+    intervalStartedAt = simTime();
+    emit(intervalSignal, (long) currentInterval);
 
     intervalTriggerEvent = new cMessage("TT interval update", TRICKLE_INTERVAL_UPDATE_EVENT);
     trickleTriggerEvent = new cMessage("TT triggered", TRICKLE_TRIGGER_EVENT);
@@ -114,7 +145,9 @@ void TrickleTimer::processSelfMessage(cMessage *message)
 
             if (currentInterval < maxInterval) {
                 if (intervalUpdatesCtn >= skipIntDoublings) {
+                    updateIntervalStats();
                     currentInterval *= intervalExponent;
+                    emit(intervalSignal, (long) currentInterval);
                     EV_INFO << "Trickle interval doubled, current - " << currentInterval << endl;
                 }
             }
@@ -167,14 +200,28 @@ bool TrickleTimer::hasStarted() {
 
 bool TrickleTimer::checkRedundancyConst() {
     Enter_Method_Silent("TrickleTimer::checkRedundancyConst()");
-    return ctrlMsgReceivedCtn < redundancyConst;
+    bool transmit = ctrlMsgReceivedCtn < redundancyConst;
+
+    if (transmit) {
+        numTransmissions++;
+        emit(transmissionSignal, (long) currentInterval);
+    }
+    else {
+        numSuppressions++;
+        emit(suppressionSignal, (long) currentInterval);
+    }
+
+    return transmit;
 }
 
-void TrickleTimer::reset() {
+void TrickleTimer::reset(int cause) {
     Enter_Method_Silent("TrickleTimer::reset()");
+    emit(resetSignal, (long) cause);
+    updateIntervalStats();
     ctrlMsgReceivedCtn = 0;
     currentInterval = pStartIntervalOverride > 0 ? pStartIntervalOverride : minInterval;
     intervalUpdatesCtn = 0;
+    emit(intervalSignal, (long) currentInterval);
     try {
         if (intervalTriggerEvent)
             cancelEvent(intervalTriggerEvent);
@@ -185,7 +232,7 @@ void TrickleTimer::reset() {
             cancelEvent(trickleTriggerEvent);
 
         scheduleAt(simTime() + currentInterval, intervalTriggerEvent);
-        EV_DETAIL << "Trickle timer reset" << endl;
+        EV_DETAIL << "Trickle timer reset, cause - " << cause << endl;
     }
     catch (std::exception &e) {
         EV_WARN << "Exception: " << e.what() <<" while resetting trickle timer, currentInterval = "
@@ -201,6 +248,9 @@ void TrickleTimer::suspend() {
         cancelEvent(intervalTriggerEvent);
     if (trickleTriggerEvent)
         cancelEvent(trickleTriggerEvent);
+    // time spent suspended doesn't count towards any interval level
+    updateIntervalStats();
+    intervalStartedAt = -1;
     EV_DETAIL << "Trickle timer suspended " << endl;
 }
 
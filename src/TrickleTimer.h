@@ -50,8 +50,25 @@ class TrickleTimer : public cSimpleModule
     uint8_t redundancyConst;
     uint8_t ctrlMsgReceivedCtn;
 
+    /** Statistics */
+    simsignal_t transmissionSignal;
+    simsignal_t suppressionSignal;
+    simsignal_t resetSignal;
+    simsignal_t intervalSignal;
+    int numTransmissions;
+    int numSuppressions;
+    simtime_t intervalStartedAt; // start of the current interval level, negative if timer is not running
+    std::map<int, simtime_t> timeAtInterval; // total time spent at each interval level (in seconds)
+
   protected:
     void initialize(int stage) override;
+    void finish() override;
+
+    /**
+     * Account time spent at the previous interval level and start
+     * measuring time for the current one
+     */
+    void updateIntervalStats();
 
   public:
     TrickleTimer();
@@ -60,7 +77,14 @@ class TrickleTimer : public cSimpleModule
     /** Lifecycle **/
     void start() { start(false, 0); };
     void start(bool warmupDelay, int skipIntervalDoublings);
-    virtual void reset();
+    void reset() { reset(TRICKLE_RESET_EXTERNAL); };
+
+    /**
+     * Reset trickle interval to the minimum value due to detected inconsistency [RFC 6206, 4.2]
+     *
+     * @param cause reason for the reset from TRICKLE_RESET_CAUSE enum, emitted as statistic
+     */
+    virtual void reset(int cause);
     virtual void stop();
     virtual void suspend();
 
@@ -72,7 +96,8 @@ class TrickleTimer : public cSimpleModule
 
     /**
      * Check if number of control messages heard in current interval is not
-     * greater than the threshold 'redundancy constant' [RFC 6206]
+     * greater than the threshold 'redundancy constant' [RFC 6206]. Since the result
+     * decides whether the routing module transmits, transmission/suppression is recorded here
      *
      * @return true if control messages heard less than the redundancy const
      * false otherwise